@@ -30,7 +30,7 @@ void ArrowsManager::update_mouse_arrow(sf::Vector2i mouse_pos)
     mouse_arrow = Arrow::make_line_from_coordinates({mouse_arrow.getPosition().x, mouse_arrow.getPosition().y}, mouse_pos, mouse_arrow.getSize().y);
 }
 
-void ArrowsManager::resize_arrows(Chess::Board &board)
+void ArrowsManager::resize_arrows(Chess::GuiBoard &board)
 {
     float width = board.square_size / 10.f;
     for (auto &line : arrows_list) {
@@ -47,7 +47,7 @@ void ArrowsManager::resize_arrows(Chess::Board &board)
     }
 }
 
-void ArrowsManager::add_arrow(int start, int end, Chess::Board &board)
+void ArrowsManager::add_arrow(int start, int end, Chess::GuiBoard &board)
 {
     for (auto it = arrows_list.begin(); it != arrows_list.end(); it++) {
         if (it->start_pos == start && it->end_pos == end) {
@@ -77,7 +77,7 @@ float Arrow::get_effective_angle(const sf::Vector2i start_pos, const sf::Vector2
     return (atan2(end_pos.x - start_pos.x, end_pos.y - start_pos.y) - M_PI_2) * -1;
 }
 
-Arrow::Arrow(int start, int end, Chess::Board &board)
+Arrow::Arrow(int start, int end, Chess::GuiBoard &board)
 {
     this->start_pos = start;
     this->end_pos = end;
@@ -1,12 +1,12 @@
 #include <SFML/Graphics.hpp>
 #include <vector>
 
-#include "chess/board.hpp"
+#include "GuiBoard.hpp"
 
 class Arrow
 {
 public:
-    Arrow(int start, int end, Chess::Board &origin);
+    Arrow(int start, int end, Chess::GuiBoard &origin);
     sf::RectangleShape shape;
     sf::CircleShape triangle;
     int start_pos;
@@ -26,8 +26,8 @@ public:
 
     void update_mouse_arrow(sf::Vector2i mouse_pos);
 
-    void resize_arrows(Chess::Board &board);
+    void resize_arrows(Chess::GuiBoard &board);
 
-    void add_arrow(int start, int end, Chess::Board &board);
+    void add_arrow(int start, int end, Chess::GuiBoard &board);
     void draw(sf::RenderWindow &window);
 };
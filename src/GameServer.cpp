@@ -0,0 +1,481 @@
+#include "GameServer.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+GameServer::GameServer(int max_games, int nb_threads) : games(std::max(max_games, 1)), pool(nb_threads), boards(pool.size())
+{
+    // A client leaving before its answers are written must not kill the server
+    std::signal(SIGPIPE, SIG_IGN);
+
+    // Popped from the back, so the lowest indexes are handed out first
+    for (int i = games.size() - 1; i >= 0; i--) {
+        free_games.push_back(i);
+    }
+}
+
+GameServer::~GameServer()
+{
+    pool.wait();
+    if (epoll_fd != -1) {
+        close(epoll_fd);
+    }
+    if (listen_fd != -1) {
+        close(listen_fd);
+    }
+}
+
+const char *GameServer::status_name(Status status)
+{
+    switch (status) {
+    case Check:
+        return "check";
+    case Checkmate:
+        return "checkmate";
+    case Stalemate:
+        return "stalemate";
+    case FiftyMoves:
+        return "fifty_moves";
+    case Repetition:
+        return "repetition";
+    case InsufficientMaterial:
+        return "insufficient_material";
+    default:
+        return "ongoing";
+    }
+}
+
+static GameServer::Status status_of(const Chess::LogInstance &entry)
+{
+    switch (entry.draw_reason) {
+    case Chess::LogInstance::Stalemate:
+        return GameServer::Stalemate;
+    case Chess::LogInstance::FiftyMoves:
+        return GameServer::FiftyMoves;
+    case Chess::LogInstance::Repetition:
+        return GameServer::Repetition;
+    case Chess::LogInstance::InsufficientMaterial:
+        return GameServer::InsufficientMaterial;
+    default:
+        break;
+    }
+    if (entry.isMate) {
+        return GameServer::Checkmate;
+    }
+    return entry.isCheck ? GameServer::Check : GameServer::Ongoing;
+}
+
+// "host:port" is a TCP address, anything else the path of a Unix socket
+int GameServer::open_socket(const std::string &address, bool listening)
+{
+    size_t colon = address.rfind(':');
+    bool is_tcp = colon != std::string::npos && colon + 1 < address.size() && address.find('/') == std::string::npos &&
+                  std::all_of(address.begin() + colon + 1, address.end(), [](char c) { return c >= '0' && c <= '9'; });
+    const char *action = listening ? "listen on " : "connect to ";
+    int fd = -1;
+
+    if (is_tcp) {
+        std::string host = colon == 0 ? "127.0.0.1" : address.substr(0, colon);
+        addrinfo hints = {};
+        addrinfo *info = nullptr;
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        if (int error = getaddrinfo(host.c_str(), address.c_str() + colon + 1, &hints, &info)) {
+            std::cerr << "Couldn't " << action << address << ": " << gai_strerror(error) << std::endl;
+            return -1;
+        }
+        int enabled = 1;
+        fd = socket(info->ai_family, SOCK_STREAM, 0);
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enabled, sizeof(enabled));
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+        bool opened = fd != -1 && (listening ? bind(fd, info->ai_addr, info->ai_addrlen) == 0 && listen(fd, SOMAXCONN) == 0
+                                             : connect(fd, info->ai_addr, info->ai_addrlen) == 0);
+        freeaddrinfo(info);
+        if (!opened) {
+            std::cerr << "Couldn't " << action << address << ": " << std::strerror(errno) << std::endl;
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    sockaddr_un socket_address = {};
+    if (address.size() >= sizeof(socket_address.sun_path)) {
+        std::cerr << "Socket path too long: " << address << std::endl;
+        return -1;
+    }
+    socket_address.sun_family = AF_UNIX;
+    std::strcpy(socket_address.sun_path, address.c_str());
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listening) {
+        unlink(address.c_str());
+    }
+    bool opened = fd != -1 && (listening ? bind(fd, (sockaddr *)&socket_address, sizeof(socket_address)) == 0 && listen(fd, SOMAXCONN) == 0
+                                         : connect(fd, (sockaddr *)&socket_address, sizeof(socket_address)) == 0);
+    if (!opened) {
+        std::cerr << "Couldn't " << action << address << ": " << std::strerror(errno) << std::endl;
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int GameServer::serve(const std::string &address)
+{
+    listen_fd = open_socket(address, true);
+    if (listen_fd == -1) {
+        return 1;
+    }
+    // Every connection waiting to be accepted is taken at once, until accept4 would block
+    fcntl(listen_fd, F_SETFL, O_NONBLOCK);
+    epoll_fd = epoll_create1(0);
+    epoll_event listen_event = {};
+    listen_event.events = EPOLLIN;
+    listen_event.data.ptr = nullptr;
+    if (epoll_fd == -1 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &listen_event) == -1) {
+        std::cerr << "Couldn't create the event loop: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    std::cerr << "Listening on " << address << " for up to " << games.size() << " games (" << sizeof(Game) << " bytes each)" << std::endl;
+
+    epoll_event events[256];
+    while (true) {
+        int nb_events = epoll_wait(epoll_fd, events, 256, -1);
+        for (int i = 0; i < nb_events; i++) {
+            if (events[i].data.ptr == nullptr) {
+                accept_connections();
+                continue;
+            }
+            // Epoll watching the connection keeps it alive until update_events releases it
+            std::shared_ptr<Connection> connection = static_cast<Connection *>(events[i].data.ptr)->shared_from_this();
+            if (events[i].events & EPOLLOUT) {
+                connection->flush_output();
+            }
+            if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !connection->reading_done) {
+                read_requests(*connection);
+            }
+        }
+    }
+}
+
+void GameServer::accept_connections()
+{
+    int client_fd;
+
+    while ((client_fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK)) != -1) {
+        int enabled = 1;
+        setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+        auto connection = std::make_shared<Connection>(client_fd, epoll_fd);
+        std::lock_guard lock(connection->write_mutex);
+        connection->update_events();
+    }
+}
+
+GameServer::Connection::~Connection()
+{
+    close(fd);
+}
+
+// Registers the events the connection still waits for, it keeps itself alive while epoll watches it.
+// Called with write_mutex held, the reference returned must be released once it is unlocked.
+std::shared_ptr<GameServer::Connection> GameServer::Connection::update_events()
+{
+    uint32_t wanted = 0;
+    std::shared_ptr<Connection> released;
+    epoll_event event = {};
+
+    if (!reading_done) {
+        wanted |= EPOLLIN;
+    }
+    if (!output.empty()) {
+        wanted |= EPOLLOUT;
+    }
+
+    if (wanted == watched_events) {
+        return released;
+    }
+    event.events = wanted;
+    event.data.ptr = this;
+    if (wanted == 0) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, &event);
+        released = std::move(self);
+    } else if (watched_events == 0) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+        self = shared_from_this();
+    } else {
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event);
+    }
+    watched_events = wanted;
+    return released;
+}
+
+// Writes what the socket accepts right away, the event loop sends the rest once it is writable
+void GameServer::Connection::write_line(std::string &line)
+{
+    std::shared_ptr<Connection> released;
+
+    line += '\n';
+    std::lock_guard lock(write_mutex);
+    if (broken) {
+        return;
+    }
+    if (output.empty()) {
+        ssize_t written = send(fd, line.data(), line.size(), MSG_NOSIGNAL);
+        if (written == -1 && errno != EAGAIN) {
+            broken = true;
+            return;
+        }
+        line.erase(0, std::max<ssize_t>(written, 0));
+    }
+    output += line;
+    released = update_events();
+}
+
+void GameServer::Connection::flush_output()
+{
+    std::shared_ptr<Connection> released;
+    std::lock_guard lock(write_mutex);
+
+    ssize_t written = output.empty() ? 0 : send(fd, output.data(), output.size(), MSG_NOSIGNAL);
+    if (written == -1 && errno != EAGAIN) {
+        broken = true;
+        output.clear();
+    }
+    output.erase(0, std::max<ssize_t>(written, 0));
+    released = update_events();
+}
+
+void GameServer::Connection::stop_reading()
+{
+    std::shared_ptr<Connection> released;
+    std::lock_guard lock(write_mutex);
+
+    reading_done = true;
+    released = update_events();
+}
+
+void GameServer::read_requests(Connection &connection)
+{
+    char chunk[65536];
+    ssize_t nb_read = read(connection.fd, chunk, sizeof(chunk));
+
+    if (nb_read == 0 || (nb_read == -1 && errno != EAGAIN)) {
+        // The answers still being computed are written once they are ready
+        connection.stop_reading();
+        return;
+    }
+    if (nb_read == -1) {
+        return;
+    }
+    connection.input.append(chunk, nb_read);
+    size_t start = 0;
+    size_t end;
+    while ((end = connection.input.find('\n', start)) != std::string::npos) {
+        std::string_view line(connection.input.data() + start, end - start);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (!line.empty()) {
+            dispatch(connection, line);
+        }
+        start = end + 1;
+    }
+    connection.input.erase(0, start);
+}
+
+// Creating a game and the stats are answered by the event loop, everything else is queued on its game
+void GameServer::dispatch(Connection &connection, std::string_view line)
+{
+    size_t separator = line.find(' ');
+    std::string_view game_token = line.substr(0, separator);
+    std::string_view command = separator == std::string_view::npos ? "" : line.substr(separator + 1);
+
+    if (game_token == "new") {
+        create_game(connection, command);
+        return;
+    }
+    if (game_token == "stats") {
+        std::string reply = "stats ok games " + std::to_string(nb_open_games.load()) + " game_bytes " + std::to_string(sizeof(Game));
+        connection.write_line(reply);
+        return;
+    }
+
+    int game_index = -1;
+    auto [end, error] = std::from_chars(game_token.data(), game_token.data() + game_token.size(), game_index);
+    Game *game = nullptr;
+    if (error == std::errc() && end == game_token.data() + game_token.size() && game_index >= 0 && game_index < (int)games.size()) {
+        game = games[game_index].get();
+    }
+    if (game) {
+        std::lock_guard lock(game->mutex);
+        if (game->in_use) {
+            game->pending.push_back({connection.shared_from_this(), std::string(command)});
+            if (!game->scheduled) {
+                game->scheduled = true;
+                pool.submit([this, game_index](int worker_index) { drain(game_index, worker_index); });
+            }
+            return;
+        }
+    }
+    std::string reply = std::string(game_token) + " error unknown game";
+    connection.write_line(reply);
+}
+
+// Free games are idle, so the event loop can set them up without racing a worker
+void GameServer::create_game(Connection &connection, std::string_view FEN)
+{
+    Chess::FenPosition parsed;
+    std::string reply;
+
+    if (Chess::FenError error = Chess::parse_FEN(FEN.empty() || FEN == "startpos" ? Chess::default_FEN : FEN, parsed)) {
+        reply = "new error " + std::string(error.message()) + " at column " + std::to_string(error.offset + 1);
+        connection.write_line(reply);
+        return;
+    }
+    int game_index;
+    {
+        std::lock_guard lock(free_mutex);
+        if (free_games.empty()) {
+            reply = "new error too many games";
+            connection.write_line(reply);
+            return;
+        }
+        game_index = free_games.back();
+        free_games.pop_back();
+    }
+    if (!games[game_index]) {
+        games[game_index] = std::make_unique<Game>();
+    }
+
+    Game &game = *games[game_index];
+    Chess::LogInstance entry;
+    loop_board.set_position(parsed);
+    loop_board.describe_result(entry, 0);
+    {
+        std::lock_guard lock(game.mutex);
+        game.position = loop_board.position();
+        game.first_clock = loop_board.halfmove_clock;
+        record_position(game, loop_board);
+        game.status = status_of(entry);
+        game.in_use = true;
+    }
+    nb_open_games += 1;
+
+    char buffer[Chess::max_FEN_length];
+    reply = std::to_string(game_index) + " ok " + status_name(game.status) + ' ';
+    reply.append(buffer, loop_board.write_FEN(buffer));
+    connection.write_line(reply);
+}
+
+void GameServer::drain(int game_index, int worker_index)
+{
+    Game &game = *games[game_index];
+    std::vector<Request> requests;
+
+    while (true) {
+        {
+            std::lock_guard lock(game.mutex);
+            if (game.pending.empty()) {
+                game.scheduled = false;
+                break;
+            }
+            requests.swap(game.pending);
+        }
+        for (auto &request : requests) {
+            std::string reply = std::to_string(game_index);
+            answer(game, boards[worker_index], request.command, reply);
+            request.connection->write_line(reply);
+        }
+        requests.clear();
+    }
+    // A closed game goes back to the free list once nothing refers to it anymore, no request can be queued on it since
+    if (!game.in_use) {
+        std::lock_guard lock(free_mutex);
+        free_games.push_back(game_index);
+        nb_open_games -= 1;
+    }
+}
+
+// Appends " ok [result]" or " error <reason>" to reply
+void GameServer::answer(Game &game, Chess::Board &board, std::string_view request, std::string &reply)
+{
+    size_t separator = request.find(' ');
+    std::string_view command = request.substr(0, separator);
+    std::string_view argument = separator == std::string_view::npos ? "" : request.substr(separator + 1);
+    char buffer[Chess::max_FEN_length];
+
+    if (!game.in_use) {
+        reply += " error unknown game";
+    } else if (command == "move") {
+        Chess::Move move;
+        if (game.status != Ongoing && game.status != Check) {
+            reply += " error game over";
+            return;
+        }
+        if (!Chess::Move::parse_UCI(argument, move)) {
+            reply += " error invalid move";
+            return;
+        }
+        board.restore(game.position);
+        move = board.with_flags(move);
+        if (!board.is_legal(move)) {
+            reply += " error illegal move";
+            return;
+        }
+        Chess::LogInstance entry;
+        board.describe_move(move, entry);
+        board.make_move(move);
+        board.describe_result(entry, count_repetitions(game, board));
+        game.position = board.position();
+        record_position(game, board);
+        game.status = status_of(entry);
+
+        reply += " ok " + entry.print_move() + ' ' + status_name(game.status) + ' ';
+        reply.append(buffer, board.write_FEN(buffer));
+    } else if (command == "state") {
+        board.restore(game.position);
+        reply += " ok ";
+        reply += status_name(game.status);
+        reply += ' ';
+        reply.append(buffer, board.write_FEN(buffer));
+    } else if (command == "close") {
+        std::lock_guard lock(game.mutex);
+        game.in_use = false;
+        reply += " ok closed";
+    } else {
+        reply += " error unknown command";
+    }
+}
+
+// Earlier occurrences of the board's position, same rule as MoveLog::count_repetitions
+int GameServer::count_repetitions(const Game &game, const Chess::Board &board) const
+{
+    int count = 0;
+
+    for (int clock = board.halfmove_clock - 2; clock >= game.first_clock && clock < 100; clock -= 2) {
+        count += game.keys[clock] == board.zobrist_hash;
+    }
+    return count;
+}
+
+void GameServer::record_position(Game &game, const Chess::Board &board)
+{
+    // The clock only goes up by one or back to zero, the game is a draw before it reaches 100
+    if (board.halfmove_clock == 0) {
+        game.first_clock = 0;
+    }
+    if (board.halfmove_clock < 100) {
+        game.keys[board.halfmove_clock] = board.zobrist_hash;
+    }
+}
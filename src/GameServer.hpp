@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "WorkStealingPool.hpp"
+#include "chess/board.hpp"
+
+// Hosts many games at once, without the GUI, on a loopback TCP address ("127.0.0.1:<port>") or a Unix socket path.
+// A single epoll loop reads every connection and the worker pool plays the moves. A request is a line:
+//   new [<FEN>|startpos]    <game> move <uci move>    <game> state    <game> close    stats
+// answered by "<game> ok [result]" or "<game> error <reason>". The moves of a game are played in order, different
+// games concurrently, and any connection can address any game.
+class GameServer
+{
+public:
+    enum Status : uint8_t { Ongoing, Check, Checkmate, Stalemate, FiftyMoves, Repetition, InsufficientMaterial };
+
+    GameServer(int max_games, int nb_threads);
+    ~GameServer();
+
+    int serve(const std::string &address);
+
+    static const char *status_name(Status status);
+    // A listening or connected stream socket, -1 once the error is printed
+    static int open_socket(const std::string &address, bool listening);
+
+private:
+    // Owned by the requests waiting on it and by itself as long as epoll watches it, the socket closes with the last owner
+    struct Connection : std::enable_shared_from_this<Connection> {
+        int fd;
+        int epoll_fd;
+        std::string input;
+
+        std::mutex write_mutex;
+        std::string output; // What the socket didn't accept yet
+        bool reading_done = false;
+        bool broken = false;
+        uint32_t watched_events = 0;
+        std::shared_ptr<Connection> self;
+
+        Connection(int fd, int epoll_fd) : fd(fd), epoll_fd(epoll_fd) {}
+        ~Connection();
+        void write_line(std::string &line);
+        void flush_output();
+        void stop_reading();
+        std::shared_ptr<Connection> update_events();
+    };
+
+    struct Request {
+        std::shared_ptr<Connection> connection;
+        std::string command;
+    };
+
+    // A game is its position and the keys the repetition rule needs, nothing grows while it is played
+    struct Game {
+        Chess::Position position;
+        uint64_t keys[100];  // Key of the position reached with each halfmove clock since the last capture or pawn move
+        int first_clock = 0; // The keys below it predate the game
+        Status status = Ongoing;
+        bool in_use = false;
+
+        std::mutex mutex;
+        std::vector<Request> pending;
+        bool scheduled = false;
+    };
+
+    void accept_connections();
+    void read_requests(Connection &connection);
+    void dispatch(Connection &connection, std::string_view line);
+    void create_game(Connection &connection, std::string_view FEN);
+    void drain(int game_index, int worker_index);
+    void answer(Game &game, Chess::Board &board, std::string_view request, std::string &reply);
+    int count_repetitions(const Game &game, const Chess::Board &board) const;
+    void record_position(Game &game, const Chess::Board &board);
+
+    std::vector<std::unique_ptr<Game>> games;
+    std::mutex free_mutex;
+    std::vector<int> free_games;
+    std::atomic<int> nb_open_games = 0;
+
+    WorkStealingPool pool;
+    std::vector<Chess::Board> boards; // One scratch board per worker, games are copied in and out of them
+    Chess::Board loop_board;
+    int listen_fd = -1;
+    int epoll_fd = -1;
+};
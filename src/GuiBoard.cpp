@@ -0,0 +1,223 @@
+#include "GuiBoard.hpp"
+
+#include <cmath>
+#include <set>
+#include <stdexcept>
+
+using namespace Chess;
+
+GuiBoard::~GuiBoard()
+{
+    delete this->promotion_popup;
+}
+
+void GuiBoard::setup_textures(std::filesystem::path path, RessourceManager *manager)
+{
+    this->manager = manager;
+    this->promotion_popup = new PromotionPopup();
+    setup_board_textures(path);
+}
+
+void GuiBoard::setup_board_textures(std::filesystem::path path)
+{
+    if (!this->texture.loadFromFile(path)) {
+        throw std::runtime_error("SFML board error");
+    }
+    this->sprite.setTexture(this->texture);
+    scale_board();
+}
+
+void GuiBoard::setup_pieces_textures()
+{
+}
+
+int GuiBoard::get_square_from_mouse(sf::Vector2i local_position)
+{
+    sf::Vector2f board_location = {local_position.x - get_origin().x, local_position.y - get_origin().y};
+
+    int true_x = std::floor(board_location.x / square_size);
+    int true_y = std::floor(board_location.y / -square_size);
+    if (true_x < 8 && true_x >= 0 && true_y < 8 && true_y >= 0) {
+        return true_y * 8 + true_x;
+    } else {
+        return -1;
+    }
+}
+
+void GuiBoard::resize_board(unsigned width, unsigned height)
+{
+    square_size = std::min(width, height) / 8;
+    scale_board();
+    scale_pieces();
+    this->promotion_popup->scale(*this);
+}
+
+void GuiBoard::scale_board()
+{
+    float scale = square_size * 8.f / this->texture.getSize().x;
+    this->sprite.setScale(scale, scale);
+
+    this->highlighted_square_shape.setSize({(float)square_size, (float)square_size});
+    this->main_highlighted_square_shape.setSize({(float)square_size, (float)square_size});
+    this->losing_square_shape.setSize({(float)square_size, (float)square_size});
+    this->highlighted_square_shape.setFillColor(sf::Color(255, 0, 0, 100));
+    this->main_highlighted_square_shape.setFillColor(sf::Color(255, 100, 0, 100));
+    this->losing_square_shape.setFillColor(sf::Color(0, 0, 0, 110));
+}
+
+void GuiBoard::scale_pieces()
+{
+    for (int i = 0; i < 12; i++) {
+        sf::Vector2u size = manager->sprite_piece_array[i].getTexture()->getSize();
+        manager->sprite_piece_array[i].setScale((float)square_size / size.x, (float)square_size / size.y);
+    }
+}
+
+sf::Vector2f GuiBoard::get_origin()
+{
+    return this->sprite.getPosition() + sf::Vector2f(0, square_size * 8);
+}
+
+void GuiBoard::play_move(Move move)
+{
+    Board::play_move(move);
+    show_last_move();
+}
+
+void GuiBoard::show_last_move()
+{
+    auto &last_move = move_history.move_history.back();
+    std::cout << last_move.print_move() << " (" << last_move.print_score() << ")" << std::endl;
+    if (last_move.isDraw) {
+        std::cout << LogInstance::describe_draw(last_move.draw_reason) << std::endl;
+    }
+}
+
+void GuiBoard::display_square_moves(int index)
+{
+    Bitboard winning_targets = 0;
+
+    moves_for_selected_piece.clear();
+    losing_targets = 0;
+    for (auto move : get_all_moves_for_square(index)) {
+        moves_for_selected_piece.push_back(move.end_pos());
+        if (see_ge(move, 0)) {
+            winning_targets |= bitboard::square_bb(move.end_pos());
+        } else {
+            losing_targets |= bitboard::square_bb(move.end_pos());
+        }
+    }
+    // A square stays untinted when one of its promotions holds
+    losing_targets &= ~winning_targets;
+    if (moves_for_selected_piece.size() != 0) {
+        selected_piece = index;
+    } else {
+        selected_piece = -1;
+    }
+}
+
+void GuiBoard::update_sprite_position(sf::RectangleShape &shape, sf::Vector2f &board_origin, int index)
+{
+    int x = index % 8;
+    int y = index / 8;
+
+    float true_x = board_origin.x + square_size * x;
+    float true_y = board_origin.y - square_size * (1 + y);
+
+    shape.setSize({(float)square_size, (float)square_size});
+    shape.setPosition({true_x, true_y});
+}
+
+void GuiBoard::draw_board(sf::RenderWindow &window)
+{
+    window.draw(this->sprite);
+    auto origin = this->get_origin();
+
+    if (selected_piece != -1) {
+        update_sprite_position(main_highlighted_square_shape, origin, selected_piece);
+        window.draw(main_highlighted_square_shape);
+        std::set<int> tmp_set;
+        for (auto s : moves_for_selected_piece) {
+            tmp_set.insert(s);
+        }
+        for (auto square : tmp_set) {
+            update_sprite_position(highlighted_square_shape, origin, square);
+            window.draw(highlighted_square_shape);
+            if (losing_targets & bitboard::square_bb(square)) {
+                update_sprite_position(losing_square_shape, origin, square);
+                window.draw(losing_square_shape);
+            }
+        }
+    }
+    Bitboard occ = occupied();
+    while (occ) {
+        auto piece = piece_at(bitboard::pop_lsb(occ));
+        auto &sprite = manager->sprite_piece_array[piece.get_texture_index()];
+        int x = piece.indexed_position % 8;
+        int y = piece.indexed_position / 8;
+        float true_x = origin.x + square_size * x;
+        float true_y = origin.y - square_size * (1 + y);
+        sprite.setPosition(true_x, true_y);
+        if (piece.indexed_position == selected_piece && is_piece_picked_up) {
+            auto mouse_pos = sf::Mouse::getPosition(window);
+            auto sprite_size = sprite.getGlobalBounds();
+            sprite.setPosition(mouse_pos.x - sprite_size.width / 2, mouse_pos.y - sprite_size.height / 2);
+        }
+        window.draw(sprite);
+    }
+    promotion_popup->draw(window, *this);
+}
+
+PromotionPopup::PromotionPopup()
+{
+    this->square.setFillColor(sf::Color(127, 127, 127, 255));
+}
+
+void PromotionPopup::show(Move move)
+{
+    visible = true;
+    this->move = move;
+    is_direction_up = this->move.end_pos() / 8 == 0;
+}
+
+void PromotionPopup::draw(sf::RenderWindow &window, GuiBoard &board)
+{
+    if (!visible) {
+        return;
+    }
+
+    auto origin = board.get_origin();
+    for (int i = 0; i < 4; i++) {
+        int index = move.end_pos() + 8 * i * (is_direction_up ? 1 : -1);
+        int x = index % 8;
+        int y = index / 8;
+
+        float true_x = origin.x + board.square_size * x;
+        float true_y = origin.y - board.square_size * (1 + y);
+
+        square.setRadius(board.square_size / 2);
+        square.setPosition({true_x, true_y});
+
+        window.draw(square);
+        int texture_index = Piece::get_texture_index(promotion_order[i], !is_direction_up);
+        auto &sprite = board.manager->sprite_piece_array[texture_index];
+        sprite.setPosition(square.getPosition());
+        window.draw(sprite);
+    }
+}
+
+void PromotionPopup::scale(GuiBoard &board)
+{
+}
+
+Piece::piece_type PromotionPopup::select(int square)
+{
+    visible = false;
+    for (int i = 0; i < 4; i++) {
+        int target_square = move.end_pos() + 8 * i * (is_direction_up ? 1 : -1);
+        if (square == target_square) {
+            return promotion_order[i];
+        }
+    }
+    return Piece::piece_type::NONE;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <filesystem>
+#include <vector>
+
+#include "chess/board.hpp"
+#include "ressourceManager.hpp"
+
+namespace Chess
+{
+
+class PromotionPopup;
+
+// A board as drawn by the GUI: the rules come from Board, this adds the textures, the selection and the promotion popup
+class GuiBoard : public Board
+{
+public:
+    int square_size = 64;
+
+    sf::Sprite sprite;
+    sf::Texture texture;
+    RessourceManager *manager = nullptr;
+
+    ~GuiBoard();
+
+    // Same as Board::play_move, the move is then printed on the console
+    void play_move(Move move);
+    void show_last_move();
+
+    void setup_textures(std::filesystem::path path, RessourceManager *manager);
+    void setup_board_textures(std::filesystem::path path);
+    void setup_pieces_textures();
+
+    void update_sprite_position(sf::RectangleShape &shape, sf::Vector2f &board_origin, int index);
+    int get_square_from_mouse(sf::Vector2i local_position);
+
+    void resize_board(unsigned width, unsigned height);
+    void scale_board();
+    void scale_pieces();
+    void display_square_moves(int index);
+
+    sf::Vector2f get_origin();
+    void draw_board(sf::RenderWindow &window);
+    bool is_piece_picked_up = false;
+
+    std::vector<int> moves_for_selected_piece;
+    Bitboard losing_targets = 0; // Targets of the selected piece where the exchange that follows loses material
+    int selected_piece = -1;
+    sf::RectangleShape highlighted_square_shape;
+    sf::RectangleShape main_highlighted_square_shape;
+    sf::RectangleShape losing_square_shape;
+
+    PromotionPopup *promotion_popup = nullptr;
+};
+
+class PromotionPopup
+{
+public:
+    PromotionPopup();
+    void show(Move move);
+    void draw(sf::RenderWindow &window, GuiBoard &board);
+    void scale(GuiBoard &board);
+    Piece::piece_type select(int square);
+
+    bool visible = false;
+    Move move;
+
+private:
+    bool is_direction_up;
+    sf::CircleShape square;
+    const Chess::Piece::piece_type promotion_order[4] = {Piece::Queen, Piece::Knight, Piece::Rook, Piece::Bishop};
+};
+
+} // namespace Chess
@@ -0,0 +1,178 @@
+#include "LoadTest.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <latch>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <unistd.h>
+#include <vector>
+
+#include "GameServer.hpp"
+#include "chess/board.hpp"
+
+std::string read_reply(int fd, std::string &buffer)
+{
+    size_t end;
+    while ((end = buffer.find('\n')) == std::string::npos) {
+        char chunk[4096];
+        ssize_t nb_read = read(fd, chunk, sizeof(chunk));
+        if (nb_read <= 0) {
+            return "";
+        }
+        buffer.append(chunk, nb_read);
+    }
+    std::string line = buffer.substr(0, end);
+    buffer.erase(0, end + 1);
+    return line;
+}
+
+int run_load_test(const std::string &address, int nb_games, int nb_connections)
+{
+    const int max_plies = 60;
+    std::latch all_opened(nb_connections);
+    std::atomic<uint64_t> nb_moves = 0;
+    std::atomic<int> nb_errors = 0;
+    std::mutex latencies_mutex;
+    std::vector<double> latencies;
+
+    auto play_games = [&](int connection_index) {
+        const int count = nb_games / nb_connections + (connection_index < nb_games % nb_connections);
+        int fd = GameServer::open_socket(address, false);
+        std::string buffer;
+        auto send_all = [fd](const std::string &requests) {
+            for (size_t written = 0; written < requests.size();) {
+                ssize_t result = write(fd, requests.data() + written, requests.size() - written);
+                if (result <= 0) {
+                    return;
+                }
+                written += result;
+            }
+        };
+
+        // The ids are the first token of the answers, which come back in request order for "new"
+        std::vector<int> ids;
+        std::vector<Chess::Position> positions;
+        std::unordered_map<int, size_t> index_of;
+        Chess::Board board;
+        board.load_from_FEN(Chess::default_FEN);
+        if (fd != -1) {
+            std::string requests;
+            for (int i = 0; i < count; i++) {
+                requests += "new\n";
+            }
+            send_all(requests);
+            for (int i = 0; i < count; i++) {
+                std::string reply = read_reply(fd, buffer);
+                if (reply.find(" ok ") == std::string::npos) {
+                    std::cerr << "new: " << reply << std::endl;
+                    nb_errors += 1;
+                    break;
+                }
+                index_of[std::stoi(reply)] = ids.size();
+                ids.push_back(std::stoi(reply));
+                positions.push_back(board.position());
+            }
+        } else {
+            nb_errors += 1;
+        }
+        all_opened.arrive_and_wait();
+        if (connection_index == 0 && fd != -1) {
+            send_all("stats\n");
+            std::cout << read_reply(fd, buffer) << std::endl;
+        }
+
+        // One move per live game and per round, the round trip of a round is timed as a whole
+        std::mt19937 random(connection_index);
+        std::vector<bool> live(ids.size(), true);
+        std::vector<double> round_trips;
+        for (int ply = 0; ply < max_plies; ply++) {
+            std::string requests;
+            size_t nb_requests = 0;
+            for (size_t i = 0; i < ids.size(); i++) {
+                if (!live[i]) {
+                    continue;
+                }
+                board.restore(positions[i]);
+                Chess::MoveList moves = board.get_all_legal_moves(board.is_white_turn);
+                Chess::Move move = moves[random() % moves.size()];
+                char uci[5];
+                requests += std::to_string(ids[i]) + " move ";
+                requests.append(uci, move.write_UCI(uci));
+                requests += '\n';
+                board.make_move(move);
+                positions[i] = board.position();
+                nb_requests += 1;
+            }
+            if (nb_requests == 0) {
+                break;
+            }
+            auto start = std::chrono::steady_clock::now();
+            send_all(requests);
+            for (size_t i = 0; i < nb_requests; i++) {
+                std::string reply = read_reply(fd, buffer);
+                // "<game> ok <SAN> <status> <FEN>"
+                size_t ok = reply.find(" ok ");
+                size_t status = ok == std::string::npos ? ok : reply.find(' ', ok + 4);
+                size_t fen = status == std::string::npos ? status : reply.find(' ', status + 1);
+                if (fen == std::string::npos) {
+                    std::cerr << "move: " << reply << std::endl;
+                    nb_errors += 1;
+                    if (reply.empty()) {
+                        break;
+                    }
+                    continue;
+                }
+                size_t index = index_of[std::stoi(reply)];
+                char expected[Chess::max_FEN_length];
+                board.restore(positions[index]);
+                if (reply.compare(fen + 1, std::string::npos, expected, board.write_FEN(expected)) != 0) {
+                    std::cerr << "FEN mismatch: " << reply << std::endl;
+                    nb_errors += 1;
+                }
+                std::string_view status_name(reply.data() + status + 1, fen - status - 1);
+                live[index] = status_name == "ongoing" || status_name == "check";
+            }
+            round_trips.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+            nb_moves += nb_requests;
+        }
+
+        std::string requests;
+        for (int id : ids) {
+            requests += std::to_string(id) + " close\n";
+        }
+        send_all(requests);
+        for (size_t i = 0; i < ids.size(); i++) {
+            read_reply(fd, buffer);
+        }
+        if (fd != -1) {
+            close(fd);
+        }
+        std::lock_guard lock(latencies_mutex);
+        latencies.insert(latencies.end(), round_trips.begin(), round_trips.end());
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < nb_connections; i++) {
+        threads.emplace_back(play_games, i);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << nb_games << " concurrent games over " << nb_connections << " connection(s): " << nb_moves << " moves in " << elapsed.count() << " s ("
+              << nb_moves / elapsed.count() << " moves/s)" << std::endl;
+    if (!latencies.empty()) {
+        std::cout << "round of one move per game: p50 " << latencies[latencies.size() / 2] << " ms, p99 " << latencies[latencies.size() * 99 / 100]
+                  << " ms" << std::endl;
+    }
+    std::cout << nb_errors << " error(s)" << std::endl;
+    return nb_errors != 0;
+}
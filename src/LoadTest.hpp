@@ -0,0 +1,11 @@
+#pragma once
+
+#include <string>
+
+// Reads one answer line of the --serve and --game-server protocols, empty once the connection is closed. What was read
+// past the line stays in buffer for the next call.
+std::string read_reply(int fd, std::string &buffer);
+
+// Opens nb_games games on a --game-server, spread over nb_connections connections with one thread each, and keeps them
+// all open while random legal moves are played in every one of them. Each answered FEN is checked against a local board.
+int run_load_test(const std::string &address, int nb_games, int nb_connections);
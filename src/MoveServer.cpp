@@ -0,0 +1,230 @@
+#include "MoveServer.hpp"
+
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+#include "chess/perft.hpp"
+
+MoveServer::MoveServer(int nb_boards, int nb_threads) : pool(nb_threads)
+{
+    // A client leaving before its answers are written must not kill the server
+    std::signal(SIGPIPE, SIG_IGN);
+
+    for (int i = 0; i < std::max(nb_boards, 1); i++) {
+        slots.push_back(std::make_unique<Slot>());
+        slots.back()->board.load_from_FEN(Chess::default_FEN);
+    }
+}
+
+MoveServer::Connection::~Connection()
+{
+    if (owns_fds) {
+        close(in_fd);
+    }
+}
+
+void MoveServer::Connection::write_line(std::string &line)
+{
+    line += '\n';
+    std::lock_guard lock(write_mutex);
+    size_t written = 0;
+    while (written < line.size()) {
+        ssize_t result = write(out_fd, line.data() + written, line.size() - written);
+        if (result <= 0) {
+            return;
+        }
+        written += result;
+    }
+}
+
+void MoveServer::serve_stream(int in_fd, int out_fd)
+{
+    read_requests(std::make_shared<Connection>(in_fd, out_fd, false));
+    pool.wait();
+}
+
+int MoveServer::serve_socket(const std::string &socket_path)
+{
+    sockaddr_un address = {};
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Socket path too long: " << socket_path << std::endl;
+        return 1;
+    }
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, socket_path.c_str());
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socket_path.c_str());
+    if (listen_fd == -1 || bind(listen_fd, (sockaddr *)&address, sizeof(address)) == -1 || listen(listen_fd, SOMAXCONN) == -1) {
+        std::cerr << "Couldn't listen on " << socket_path << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    std::cerr << "Listening on " << socket_path << std::endl;
+
+    // One reader thread per client, the answers are computed by the shared pool
+    while (true) {
+        int client_fd = accept(listen_fd, nullptr, nullptr);
+        if (client_fd == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            // Out of file descriptors: the clients already connected have to close some first
+            if (errno == EMFILE || errno == ENFILE) {
+                std::cerr << "accept: " << std::strerror(errno) << ", retrying in 100 ms" << std::endl;
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                continue;
+            }
+            std::cerr << "accept: " << std::strerror(errno) << std::endl;
+            close(listen_fd);
+            return 1;
+        }
+        auto connection = std::make_shared<Connection>(client_fd, client_fd, true);
+        std::thread([this, connection] { read_requests(connection); }).detach();
+    }
+}
+
+void MoveServer::read_requests(const std::shared_ptr<Connection> &connection)
+{
+    std::string buffer;
+    char chunk[65536];
+    ssize_t nb_read;
+
+    while ((nb_read = read(connection->in_fd, chunk, sizeof(chunk))) > 0) {
+        buffer.append(chunk, nb_read);
+        size_t start = 0;
+        size_t end;
+        while ((end = buffer.find('\n', start)) != std::string::npos) {
+            std::string_view line(buffer.data() + start, end - start);
+            if (!line.empty() && line.back() == '\r') {
+                line.remove_suffix(1);
+            }
+            if (!line.empty()) {
+                dispatch(connection, line);
+            }
+            start = end + 1;
+        }
+        buffer.erase(0, start);
+    }
+}
+
+// Queues the request on its board, the board is handed to the pool unless a worker is already draining it
+void MoveServer::dispatch(const std::shared_ptr<Connection> &connection, std::string_view line)
+{
+    size_t separator = line.find(' ');
+    std::string_view board_token = line.substr(0, separator);
+    int board_index = -1;
+    auto [end, error] = std::from_chars(board_token.data(), board_token.data() + board_token.size(), board_index);
+
+    if (error != std::errc() || end != board_token.data() + board_token.size() || board_index < 0 || board_index >= (int)slots.size()) {
+        std::string reply = std::string(board_token) + " error unknown board";
+        connection->write_line(reply);
+        return;
+    }
+
+    Slot &slot = *slots[board_index];
+    std::lock_guard lock(slot.mutex);
+    slot.pending.push_back({connection, std::string(separator == std::string_view::npos ? "" : line.substr(separator + 1))});
+    if (!slot.scheduled) {
+        slot.scheduled = true;
+        pool.submit([this, board_index](int) { drain(board_index); });
+    }
+}
+
+void MoveServer::drain(int board_index)
+{
+    Slot &slot = *slots[board_index];
+
+    while (true) {
+        Request request;
+        {
+            std::lock_guard lock(slot.mutex);
+            if (slot.pending.empty()) {
+                slot.scheduled = false;
+                return;
+            }
+            request = std::move(slot.pending.front());
+            slot.pending.pop_front();
+        }
+        std::string reply = std::to_string(board_index);
+        answer(board_index, request.line, reply);
+        request.connection->write_line(reply);
+    }
+}
+
+// Appends " ok [result]" or " error <reason>" to reply
+void MoveServer::answer(int board_index, std::string_view request, std::string &reply)
+{
+    Slot &slot = *slots[board_index];
+    Chess::Board &board = slot.board;
+    size_t separator = request.find(' ');
+    std::string_view command = request.substr(0, separator);
+    std::string_view argument = separator == std::string_view::npos ? "" : request.substr(separator + 1);
+
+    if (command == "position") {
+        Chess::FenPosition position;
+        if (Chess::FenError error = Chess::parse_FEN(argument == "startpos" ? Chess::default_FEN : argument, position)) {
+            reply += " error ";
+            reply += error.message();
+            reply += " at column " + std::to_string(error.offset + 1);
+            return;
+        }
+        board.set_position(position);
+        slot.undo_stack.clear();
+        reply += " ok";
+    } else if (command == "fen") {
+        char buffer[Chess::max_FEN_length];
+        reply += " ok ";
+        reply.append(buffer, board.write_FEN(buffer));
+    } else if (command == "moves") {
+        Chess::MoveList moves = board.get_all_legal_moves(board.is_white_turn);
+        reply += " ok " + std::to_string(moves.size());
+        for (auto move : moves) {
+            char buffer[5];
+            reply += ' ';
+            reply.append(buffer, move.write_UCI(buffer));
+        }
+    } else if (command == "play") {
+        Chess::Move move;
+        if (!Chess::Move::parse_UCI(argument, move)) {
+            reply += " error invalid move";
+            return;
+        }
+        move = board.with_flags(move);
+        if (!board.is_legal(move)) {
+            reply += " error illegal move";
+            return;
+        }
+        slot.undo_stack.push_back(board.make_move(move));
+        reply += " ok";
+    } else if (command == "undo") {
+        if (slot.undo_stack.empty()) {
+            reply += " error nothing to undo";
+            return;
+        }
+        board.unmake_move(slot.undo_stack.back());
+        slot.undo_stack.pop_back();
+        reply += " ok";
+    } else if (command == "perft") {
+        int depth = 0;
+        auto [end, error] = std::from_chars(argument.data(), argument.data() + argument.size(), depth);
+        if (error != std::errc() || end != argument.data() + argument.size() || depth < 1) {
+            reply += " error invalid depth";
+            return;
+        }
+        if (depth > max_perft_depth) {
+            reply += " error depth above " + std::to_string(max_perft_depth);
+            return;
+        }
+        reply += " ok " + std::to_string(Chess::perft(board, depth));
+    } else {
+        reply += " error unknown command";
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "WorkStealingPool.hpp"
+#include "chess/board.hpp"
+
+// Answers newline separated requests "<board> <command> [arguments]" on a fixed pool of boards, without the GUI:
+//   position <FEN>|startpos    fen    moves    play <uci move>    undo    perft <depth>
+// Each answer is a line "<board> ok [result]" or "<board> error <reason>". Requests can be pipelined: those on one
+// board are answered in order, different boards are answered concurrently by the worker threads.
+class MoveServer
+{
+public:
+    // Deeper perft requests are refused, a single one would otherwise keep a worker busy for hours
+    static constexpr int max_perft_depth = 6;
+
+    MoveServer(int nb_boards, int nb_threads);
+
+    // Both return once the input is closed and every request read from it has been answered
+    void serve_stream(int in_fd, int out_fd);
+    int serve_socket(const std::string &socket_path);
+
+private:
+    struct Connection {
+        int in_fd;
+        int out_fd;
+        bool owns_fds;
+        std::mutex write_mutex;
+
+        Connection(int in_fd, int out_fd, bool owns_fds) : in_fd(in_fd), out_fd(out_fd), owns_fds(owns_fds) {}
+        ~Connection();
+        void write_line(std::string &line);
+    };
+
+    struct Request {
+        std::shared_ptr<Connection> connection;
+        std::string line;
+    };
+
+    struct Slot {
+        Chess::Board board;
+        std::vector<Chess::UndoInfo> undo_stack;
+        std::mutex mutex;
+        std::deque<Request> pending;
+        bool scheduled = false;
+    };
+
+    void read_requests(const std::shared_ptr<Connection> &connection);
+    void dispatch(const std::shared_ptr<Connection> &connection, std::string_view line);
+    void drain(int board_index);
+    void answer(int board_index, std::string_view request, std::string &reply);
+
+    std::vector<std::unique_ptr<Slot>> slots;
+    WorkStealingPool pool;
+};
@@ -0,0 +1,111 @@
+#include "WorkStealingPool.hpp"
+
+static thread_local WorkStealingPool *current_pool = nullptr;
+static thread_local int current_worker = -1;
+
+WorkStealingPool::WorkStealingPool(int nb_threads)
+{
+    nb_threads = std::max(nb_threads, 1);
+    for (int i = 0; i < nb_threads; i++) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (int i = 0; i < nb_threads; i++) {
+        threads.emplace_back(&WorkStealingPool::worker_loop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard lock(sleep_mutex);
+        stopping = true;
+    }
+    work_available.notify_all();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::submit(Task task)
+{
+    size_t index = current_pool == this ? current_worker : next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+
+    // Counted as pending before it can run, so wait() never sees 0 while it is queued
+    pending_tasks.fetch_add(1);
+    {
+        std::lock_guard lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    // A worker counts itself as sleeping before it checks queued_tasks, so one of the two sides sees the other
+    queued_tasks.fetch_add(1);
+    if (nb_sleeping.load() > 0) {
+        std::lock_guard lock(sleep_mutex);
+        work_available.notify_one();
+    }
+}
+
+void WorkStealingPool::wait()
+{
+    std::unique_lock lock(sleep_mutex);
+    all_done.wait(lock, [&] { return pending_tasks.load() == 0; });
+}
+
+bool WorkStealingPool::pop_task(int worker_index, Task &task)
+{
+    {
+        Queue &own = *queues[worker_index];
+        std::lock_guard lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t i = 1; i < queues.size(); i++) {
+        Queue &victim = *queues[(worker_index + i) % queues.size()];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::worker_loop(int worker_index)
+{
+    current_pool = this;
+    current_worker = worker_index;
+
+    int idle_rounds = 0;
+    while (true) {
+        Task task;
+        if (pop_task(worker_index, task)) {
+            idle_rounds = 0;
+            queued_tasks.fetch_sub(1);
+            task(worker_index);
+            if (pending_tasks.fetch_sub(1) == 1) {
+                std::lock_guard lock(sleep_mutex);
+                all_done.notify_all();
+            }
+            continue;
+        }
+        // A few more looks before sleeping, tasks submitted one at a time usually come right after each other
+        if (++idle_rounds < 64) {
+            std::this_thread::yield();
+            continue;
+        }
+        idle_rounds = 0;
+
+        // Every deque looked empty. queued_tasks can still be positive for a moment while another worker takes the
+        // last task, the loop then scans the deques again before sleeping.
+        std::unique_lock lock(sleep_mutex);
+        nb_sleeping.fetch_add(1);
+        work_available.wait(lock, [&] { return stopping || queued_tasks.load() > 0; });
+        nb_sleeping.fetch_sub(1);
+        if (stopping && queued_tasks.load() == 0) {
+            return;
+        }
+    }
+}
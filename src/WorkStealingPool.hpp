@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of workers, each owning a deque of tasks.
+// A worker pops its own newest task first and steals the oldest task of another worker when it runs dry,
+// so uneven subtrees get balanced without a central queue. Only the deque touched is locked, the counts are atomics
+// and sleep_mutex is only taken by workers going to sleep and by whoever has to wake them.
+class WorkStealingPool
+{
+public:
+    typedef std::function<void(int worker_index)> Task;
+
+    explicit WorkStealingPool(int nb_threads);
+    ~WorkStealingPool();
+
+    // Called from a worker, the task goes on that worker's own deque
+    void submit(Task task);
+    void wait();
+    inline int size() const { return threads.size(); }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool pop_task(int worker_index, Task &task);
+    void worker_loop(int worker_index);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+
+    std::atomic<int> queued_tasks = 0;  // In a deque, not taken by a worker yet
+    std::atomic<int> pending_tasks = 0; // Submitted and not finished
+    std::atomic<int> nb_sleeping = 0;
+    std::atomic<unsigned> next_queue = 0;
+    std::atomic<bool> stopping = false;
+
+    std::mutex sleep_mutex;
+    std::condition_variable work_available;
+    std::condition_variable all_done;
+};
@@ -0,0 +1,392 @@
+#include "bench.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+#include "LoadTest.hpp"
+#include "MoveServer.hpp"
+#include "chess/attack_maps.hpp"
+#include "chess/board.hpp"
+#include "chess/epd.hpp"
+#include "chess/fen.hpp"
+#include "chess/perft.hpp"
+#include "chess/polyglot.hpp"
+#include "chess/Search.hpp"
+
+// The published perft test positions, used by the micro benchmarks when no EPD file is given
+static const char *bench_positions[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+};
+
+std::vector<std::string> load_bench_positions(const std::optional<std::string> &epd_path)
+{
+    std::vector<std::string> positions;
+
+    if (!epd_path) {
+        return std::vector<std::string>(std::begin(bench_positions), std::end(bench_positions));
+    }
+    std::ifstream epd_file(*epd_path);
+    std::string line;
+    Chess::EpdEntry entry;
+    while (std::getline(epd_file, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (Chess::parse_epd_line(line, entry)) {
+            positions.push_back(entry.fen);
+        }
+    }
+    if (positions.empty()) {
+        std::cerr << "No position found in: " << *epd_path << std::endl;
+    }
+    return positions;
+}
+
+// Runs function on every position in turn, about the same total number of times whatever the number of positions
+template <typename Function> static void time_bench(const char *label, size_t nb_positions, Function function)
+{
+    const size_t iterations = std::max<size_t>(1000000 / nb_positions, 1) * nb_positions;
+    auto start = std::chrono::steady_clock::now();
+    uint64_t checksum = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        checksum += function(i % nb_positions);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << label << ": " << elapsed.count() * 1e9 / iterations << " ns/op (checksum " << checksum << ")" << std::endl;
+}
+
+static int bench_fen(const std::vector<std::string> &positions)
+{
+    std::vector<Chess::Board> boards(positions.size());
+    for (size_t i = 0; i < positions.size(); i++) {
+        boards[i].load_from_FEN(positions[i]);
+    }
+
+    time_bench("parse_FEN", positions.size(), [&positions](size_t i) {
+        Chess::FenPosition position;
+        Chess::parse_FEN(positions[i], position);
+        return position.by_color[Chess::White];
+    });
+    Chess::Board board;
+    time_bench("load_from_FEN", positions.size(), [&board, &positions](size_t i) {
+        board.load_from_FEN(positions[i]);
+        return board.zobrist_hash;
+    });
+    time_bench("write_FEN", positions.size(), [&boards](size_t i) {
+        char buffer[Chess::max_FEN_length];
+        return boards[i].write_FEN(buffer);
+    });
+    time_bench("get_FEN", positions.size(), [&boards](size_t i) { return boards[i].get_FEN().size(); });
+    return 0;
+}
+
+static int bench_movegen(const std::vector<std::string> &positions)
+{
+    std::vector<Chess::Board> boards(positions.size());
+    for (size_t i = 0; i < positions.size(); i++) {
+        boards[i].load_from_FEN(positions[i]);
+    }
+
+    time_bench("get_all_legal_moves", positions.size(), [&boards](size_t i) {
+        return boards[i].get_all_legal_moves(boards[i].is_white_turn).size();
+    });
+    time_bench("make_move/unmake_move of every legal move", positions.size(), [&boards](size_t i) {
+        Chess::Board &board = boards[i];
+        uint64_t hashes = 0;
+        for (auto &move : board.get_all_legal_moves(board.is_white_turn)) {
+            Chess::UndoInfo undo = board.make_move(move);
+            hashes += board.zobrist_hash;
+            board.unmake_move(undo);
+        }
+        return hashes;
+    });
+    time_bench("copy-make of every legal move", positions.size(), [&boards](size_t i) {
+        Chess::Board &board = boards[i];
+        Chess::Position copy = board;
+        uint64_t hashes = 0;
+        for (auto &move : board.get_all_legal_moves(board.is_white_turn)) {
+            board.make_move(move);
+            hashes += board.zobrist_hash;
+            board.restore(copy);
+        }
+        return hashes;
+    });
+    std::vector<Chess::MoveList> legal_moves(positions.size());
+    for (size_t i = 0; i < positions.size(); i++) {
+        legal_moves[i] = boards[i].get_all_legal_moves(boards[i].is_white_turn);
+    }
+    time_bench("is_legal of every legal move", positions.size(), [&boards, &legal_moves](size_t i) {
+        size_t nb_legal = 0;
+        for (auto move : legal_moves[i]) {
+            nb_legal += boards[i].is_legal(move);
+        }
+        return nb_legal;
+    });
+    time_bench("see of every legal move", positions.size(), [&boards, &legal_moves](size_t i) {
+        int64_t total = 0;
+        for (auto move : legal_moves[i]) {
+            total += boards[i].see(move);
+        }
+        return total;
+    });
+    time_bench("see_ge 0 of every legal move", positions.size(), [&boards, &legal_moves](size_t i) {
+        size_t nb_safe = 0;
+        for (auto move : legal_moves[i]) {
+            nb_safe += boards[i].see_ge(move, 0);
+        }
+        return nb_safe;
+    });
+    time_bench("perft 2", positions.size(), [&boards](size_t i) { return Chess::perft(boards[i], 2); });
+    return 0;
+}
+
+// Attack maps of the sliders of both colors, one lookup per piece against the Kogge-Stone kernels
+static int bench_attacks(const std::vector<std::string> &positions)
+{
+    std::vector<Chess::bitboard::SliderSet> sets(2 * positions.size());
+    Chess::Board board;
+    for (size_t i = 0; i < positions.size(); i++) {
+        board.load_from_FEN(positions[i]);
+        sets[2 * i] = board.sliders(true, board.occupied());
+        sets[2 * i + 1] = board.sliders(false, board.occupied());
+    }
+
+    time_bench("per piece lookups", positions.size(), [&sets](size_t i) {
+        Chess::Bitboard checksum = 0;
+        for (size_t color = 0; color < 2; color++) {
+            const Chess::bitboard::SliderSet &set = sets[2 * i + color];
+            Chess::Bitboard attacks = 0;
+            for (Chess::Bitboard bb = set.orthogonals; bb;) {
+                attacks |= Chess::bitboard::rook_attacks(Chess::bitboard::pop_lsb(bb), set.occupied);
+            }
+            for (Chess::Bitboard bb = set.diagonals; bb;) {
+                attacks |= Chess::bitboard::bishop_attacks(Chess::bitboard::pop_lsb(bb), set.occupied);
+            }
+            checksum += attacks;
+        }
+        return checksum;
+    });
+    time_bench("Kogge-Stone scalar", positions.size(), [&sets](size_t i) {
+        Chess::Bitboard attacks[2];
+        Chess::bitboard::slider_attack_maps_scalar(&sets[2 * i], 2, attacks);
+        return attacks[0] + attacks[1];
+    });
+    if (Chess::bitboard::cpu_has_avx2()) {
+        time_bench("Kogge-Stone avx2", positions.size(), [&sets](size_t i) {
+            Chess::Bitboard attacks[2];
+            Chess::bitboard::slider_attack_maps_avx2(&sets[2 * i], 2, attacks);
+            return attacks[0] + attacks[1];
+        });
+    }
+    time_bench("slider_attack_maps", positions.size(), [&sets](size_t i) {
+        Chess::Bitboard attacks[2];
+        Chess::bitboard::slider_attack_maps(&sets[2 * i], 2, attacks);
+        return attacks[0] + attacks[1];
+    });
+    std::cout << "Kernel in use: " << Chess::bitboard::slider_kernel_name() << std::endl;
+    return 0;
+}
+
+// Lookups of the positions in the --book file, from the key to the legal book moves. The first lookups of a book on a
+// cold cache wait for the disk, so the times are only for pages already mapped.
+static int bench_book(const std::vector<std::string> &positions, OpeningBook &book)
+{
+    std::vector<Chess::Board> boards(positions.size());
+    size_t nb_in_book = 0;
+
+    if (!book.book.size()) {
+        std::cerr << "The book benchmark needs a --book file" << std::endl;
+        return 1;
+    }
+    for (size_t i = 0; i < positions.size(); i++) {
+        boards[i].load_from_FEN(positions[i]);
+        nb_in_book += !book.book.moves(boards[i]).empty();
+    }
+    std::cout << book.book.size() << " entries, " << nb_in_book << "/" << positions.size() << " positions in book" << std::endl;
+    time_bench("polyglot key", positions.size(), [&boards](size_t i) { return Chess::polyglot::key(boards[i]); });
+    time_bench("book moves", positions.size(), [&boards, &book](size_t i) { return book.book.moves(boards[i]).size(); });
+    time_bench("book pick", positions.size(), [&boards, &book](size_t i) { return book.pick(boards[i]).data; });
+    return 0;
+}
+
+// Evaluations per second after every legal move of every position, with each kernel the CPU supports. The incremental
+// lines update the accumulator through make_move/unmake_move, the refresh lines rebuild it from every piece.
+static int bench_nnue(const std::vector<std::string> &positions, const Chess::nnue::Network *network)
+{
+    std::unique_ptr<Chess::nnue::Network> built;
+    if (!network) {
+        built = std::make_unique<Chess::nnue::Network>();
+        Chess::nnue::build_from_tables(*built);
+        network = built.get();
+    }
+    std::vector<Chess::Board> boards(positions.size());
+    std::vector<Chess::MoveList> legal_moves(positions.size());
+    uint64_t nb_evals = 0;
+    for (size_t i = 0; i < positions.size(); i++) {
+        boards[i].load_from_FEN(positions[i]);
+        legal_moves[i] = boards[i].get_all_legal_moves(boards[i].is_white_turn);
+        nb_evals += legal_moves[i].size();
+    }
+    const uint64_t rounds = std::max<uint64_t>(1000000 / std::max<uint64_t>(nb_evals, 1), 1);
+
+    auto time_evals = [&](const std::string &label, auto evaluate) {
+        auto start = std::chrono::steady_clock::now();
+        int64_t checksum = 0;
+        for (uint64_t round = 0; round < rounds; round++) {
+            for (size_t i = 0; i < positions.size(); i++) {
+                Chess::Board &board = boards[i];
+                for (auto move : legal_moves[i]) {
+                    Chess::UndoInfo undo = board.make_move(move);
+                    checksum += evaluate(board);
+                    board.unmake_move(undo);
+                }
+            }
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << label << ": " << (uint64_t)(rounds * nb_evals / elapsed.count()) << " evals/s (checksum " << checksum << ")" << std::endl;
+    };
+
+    time_evals("piece-square tables", [](const Chess::Board &board) { return board.evaluate(); });
+    std::string best_kernel = Chess::nnue::kernel_name();
+    for (auto kernel : Chess::nnue::available_kernels()) {
+        Chess::nnue::select_kernel(kernel);
+        for (auto &board : boards) {
+            board.set_network(network);
+        }
+        time_evals(std::string("nnue ") + kernel + " incremental", [](const Chess::Board &board) { return board.evaluate(); });
+        time_evals(std::string("nnue ") + kernel + " refresh", [network](const Chess::Board &board) {
+            Chess::nnue::Accumulator accumulator;
+            Chess::nnue::refresh(*network, board, accumulator);
+            return Chess::nnue::evaluate(*network, accumulator, board.is_white_turn);
+        });
+        for (auto &board : boards) {
+            board.set_network(nullptr);
+        }
+    }
+    Chess::nnue::select_kernel(best_kernel);
+    std::cout << nb_evals << " evaluations per round, kernel in use: " << best_kernel << std::endl;
+    return 0;
+}
+
+// Round trip latency of depth 1 requests ("moves") to an in-process --serve over a socket pair, then the throughput of
+// pipelined requests spread over every board
+static int bench_serve(const std::vector<std::string> &positions, int nb_threads)
+{
+    const size_t nb_boards = std::min<size_t>(positions.size(), 64);
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1) {
+        std::cerr << "Couldn't create a socket pair" << std::endl;
+        return 1;
+    }
+    MoveServer server(nb_boards, nb_threads);
+    std::thread server_thread([&server, &fds] { server.serve_stream(fds[1], fds[1]); });
+    std::string buffer;
+    auto send = [&fds](const std::string &request) { return write(fds[0], request.data(), request.size()) == (ssize_t)request.size(); };
+
+    for (size_t i = 0; i < nb_boards; i++) {
+        send(std::to_string(i) + " position " + positions[i] + "\n");
+        read_reply(fds[0], buffer);
+    }
+
+    const size_t nb_requests = 100000;
+    std::vector<double> latencies;
+    uint64_t checksum = 0;
+    for (size_t i = 0; i < nb_requests; i++) {
+        auto start = std::chrono::steady_clock::now();
+        send(std::to_string(i % nb_boards) + " moves\n");
+        checksum += read_reply(fds[0], buffer).size();
+        latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << "moves round trip: p50 " << latencies[nb_requests / 2] << " us, p99 " << latencies[nb_requests * 99 / 100] << " us (checksum "
+              << checksum << ")" << std::endl;
+
+    // Requests are sent in batches so neither side blocks on a full socket buffer
+    const size_t batch_size = 256;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t sent = 0; sent < nb_requests; sent += batch_size) {
+        std::string batch;
+        for (size_t i = 0; i < batch_size; i++) {
+            batch += std::to_string((sent + i) % nb_boards) + " moves\n";
+        }
+        send(batch);
+        for (size_t i = 0; i < batch_size; i++) {
+            checksum += read_reply(fds[0], buffer).size();
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "pipelined moves: " << nb_requests / elapsed.count() << " requests/s on " << nb_threads << " thread(s) (checksum " << checksum << ")"
+              << std::endl;
+
+    shutdown(fds[0], SHUT_WR);
+    server_thread.join();
+    close(fds[0]);
+    close(fds[1]);
+    return 0;
+}
+
+// Node count and speed of a search of every position, limited by nodes so the bench stays short on large files
+static int bench_search(const std::vector<std::string> &positions, const Chess::nnue::Network *network)
+{
+    Chess::Search search(16);
+    Chess::Board board;
+    Chess::SearchLimits limits;
+    uint64_t nodes = 0;
+    double seconds = 0;
+    int depths = 0;
+
+    limits.nodes = positions.size() > 100 ? 10000 : 1000000;
+    board.set_network(network);
+    for (auto &position : positions) {
+        board.load_from_FEN(position);
+        search.clear();
+        Chess::SearchResult result = search.run(board, limits);
+        nodes += result.nodes;
+        seconds += result.seconds;
+        depths += result.depth;
+    }
+    std::cout << "search: " << nodes << " nodes in " << seconds << " s, " << (uint64_t)(nodes / seconds) << " nodes/s, average depth "
+              << (double)depths / positions.size() << " (" << limits.nodes << " nodes per position)" << std::endl;
+    return 0;
+}
+
+int run_bench(const std::string &name, const std::optional<std::string> &epd_path, int nb_threads, const Chess::nnue::Network *network,
+              OpeningBook &book)
+{
+    if (name != "fen" && name != "movegen" && name != "attacks" && name != "serve" && name != "search" && name != "nnue" && name != "book") {
+        std::cerr << "Unknown benchmark: " << name << " (available: fen, movegen, attacks, serve, search, nnue, book)" << std::endl;
+        return 1;
+    }
+    std::vector<std::string> positions = load_bench_positions(epd_path);
+    if (positions.empty()) {
+        return 1;
+    }
+    if (name == "attacks") {
+        return bench_attacks(positions);
+    }
+    if (name == "serve") {
+        return bench_serve(positions, nb_threads);
+    }
+    if (name == "search") {
+        return bench_search(positions, network);
+    }
+    if (name == "nnue") {
+        return bench_nnue(positions, network);
+    }
+    if (name == "book") {
+        return bench_book(positions, book);
+    }
+    return name == "fen" ? bench_fen(positions) : bench_movegen(positions);
+}
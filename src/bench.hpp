@@ -0,0 +1,16 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "chess/nnue.hpp"
+#include "cli.hpp"
+
+// The FEN of every position of the EPD file, or the perft test positions when there is none
+std::vector<std::string> load_bench_positions(const std::optional<std::string> &epd_path);
+
+// Runs the micro benchmark of this name (fen, movegen, attacks, serve, search, nnue, book) on the positions of the EPD
+// file or on the perft test positions
+int run_bench(const std::string &name, const std::optional<std::string> &epd_path, int nb_threads, const Chess::nnue::Network *network,
+              OpeningBook &book);
@@ -1,5 +1,6 @@
 #include "MoveLog.hpp"
 
+#include <cstdio>
 #include <fstream>
 #include <iostream>
 namespace Chess
@@ -9,11 +10,12 @@ MoveLog::MoveLog()
     init_new_move();
 }
 
-void MoveLog::reset(std::string FEN)
+void MoveLog::reset(std::string FEN, uint64_t key)
 {
     move_history.clear();
     ply_index = -1;
     starting_FEN = FEN;
+    starting_key = key;
     init_new_move();
 }
 
@@ -31,6 +33,8 @@ void Chess::MoveLog::init_new_move()
     cur_move.isCastle = false;
     cur_move.isCheck = false;
     cur_move.isMate = false;
+    cur_move.isDraw = false;
+    cur_move.draw_reason = LogInstance::NoDraw;
     cur_move.showFile = false;
     cur_move.showRank = false;
 }
@@ -61,6 +65,22 @@ std::string MoveLog::get_active_fen()
     return move_history[ply_index].fen;
 }
 
+// Counts earlier occurrences of the position about to be pushed. Only positions with the same side to move
+// since the last capture or pawn move (given by the halfmove clock) can repeat, so at most 50 keys are compared.
+int MoveLog::count_repetitions(uint64_t key, int halfmove_clock)
+{
+    int new_ply = ply_index + 1;
+    int count = 0;
+
+    for (int ply = new_ply - 2; ply >= -1 && ply >= new_ply - halfmove_clock; ply -= 2) {
+        uint64_t previous_key = ply == -1 ? starting_key : move_history[ply].position_key;
+        if (previous_key == key) {
+            count += 1;
+        }
+    }
+    return count;
+}
+
 void MoveLog::write_PGN(path file_path)
 {
     std::ofstream PGN_file;
@@ -85,7 +105,15 @@ void MoveLog::write_PGN(path file_path)
             PGN_file << move_counter << ". ";
             move_counter++;
         }
-        PGN_file << move.print_move() << " ";
+        PGN_file << move.print_move() << " {[%eval " << move.print_score() << "]} ";
+    }
+    if (ply_index != -1) {
+        auto &last_move = move_history[ply_index];
+        if (last_move.isMate) {
+            PGN_file << (last_move.piece.is_white ? "1-0" : "0-1");
+        } else if (last_move.isDraw) {
+            PGN_file << "{" << LogInstance::describe_draw(last_move.draw_reason) << "} 1/2-1/2";
+        }
     }
     PGN_file.flush();
     PGN_file.close();
@@ -99,7 +127,7 @@ LogInstance *MoveLog::operator->()
 std::string LogInstance::print_move()
 {
     if (isCastle) {
-        if (move.start_pos < move.end_pos) {
+        if (move.start_pos() < move.end_pos()) {
             return "O-O";
         } else {
             return "O-O-O";
@@ -107,23 +135,24 @@ std::string LogInstance::print_move()
     }
     std::string res = "";
 
-    char c = this->piece.print_piece();
+    // SAN letters are upper case whoever moves
+    char c = Piece::print_piece(this->piece.type, true);
     if (c != 0) {
         res += c;
     }
     if (showFile || (this->piece.type == Piece::Pawn && isCapture)) {
-        res += 'a' + move.start_pos % 8;
+        res += 'a' + move.start_pos() % 8;
     }
     if (showRank) {
-        res += '1' + move.start_pos / 8;
+        res += '1' + move.start_pos() / 8;
     }
     if (isCapture) {
         res += "x";
     }
-    res += Move::to_string(move.end_pos);
-    if (move.promotion != Piece::piece_type::NONE) {
+    res += Move::to_string(move.end_pos());
+    if (move.promotion() != Piece::piece_type::NONE) {
         res += '=';
-        res += Piece::print_piece(move.promotion, true);
+        res += Piece::print_piece(move.promotion(), true);
     }
 
     if (isMate) {
@@ -135,13 +164,27 @@ std::string LogInstance::print_move()
     return res;
 }
 
-std::ostream &operator<<(std::ostream &os, Move move)
+std::string LogInstance::print_score() const
+{
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%.2f", score / 100.0);
+    return buffer;
+}
+
+const char *LogInstance::describe_draw(draw_type reason)
 {
-    os << Move::get_clean_coordinate(move.start_pos) << Move::get_clean_coordinate(move.end_pos);
-    if (move.promotion != Piece::piece_type::NONE) {
-        os << Piece::print_piece(move.promotion, false);
+    switch (reason) {
+    case Stalemate:
+        return "Draw by stalemate";
+    case FiftyMoves:
+        return "Draw by the fifty-move rule";
+    case Repetition:
+        return "Draw by threefold repetition";
+    case InsufficientMaterial:
+        return "Draw by insufficient material";
+    default:
+        return "";
     }
-    return os;
 }
 
 } // namespace Chess
\ No newline at end of file
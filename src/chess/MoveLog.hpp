@@ -2,6 +2,7 @@
 #include <string.h>
 #include <vector>
 
+#include "move.hpp"
 #include "piece.hpp"
 
 using std::filesystem::path;
@@ -10,40 +11,55 @@ namespace Chess
 {
 
 const char default_FEN[57] = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
-struct Move {
-    int start_pos;
-    int end_pos;
-    Piece::piece_type promotion = Piece::NONE;
-
-    static std::string get_clean_coordinate(char pos);
-    static std::string to_string(int pos);
-    inline Move(int spos, int epos) : start_pos(spos), end_pos(epos) {}
-    inline Move() : start_pos(-1), end_pos(-1) {}
-    bool operator==(const Move &other) const;
+
+// Everything make_move overwrites, so unmake_move can restore the position in place
+struct UndoInfo {
+    Move move;
+    Piece::piece_type moved_type = Piece::NONE;
+    Piece::piece_type captured_type = Piece::NONE;
+    int captured_square = -1;
+
+    bool king_white_castle;
+    bool queen_white_castle;
+    bool king_black_castle;
+    bool queen_black_castle;
+    int en_passant_square;
+    int halfmove_clock;
+    int fullmove_number;
+    uint64_t zobrist_hash;
 };
 
 struct LogInstance {
+    enum draw_type { NoDraw, Stalemate, FiftyMoves, Repetition, InsufficientMaterial };
+
     LogInstance(){};
 
     std::string fen;
+    uint64_t position_key;
+    int score = 0; // Static evaluation of the position reached, in centipawns for white
     Move move;
+    UndoInfo undo;
     Piece piece;
     bool isCapture;
     bool isCheck;
     bool isCastle;
     bool isMate;
     bool isDraw;
+    draw_type draw_reason;
     bool showRank;
     bool showFile;
 
     std::string print_move();
+    // The score in pawns, "0.35" or "-1.20"
+    std::string print_score() const;
+    static const char *describe_draw(draw_type reason);
 };
 
 class MoveLog
 {
 public:
     MoveLog();
-    void reset(std::string FEN);
+    void reset(std::string FEN, uint64_t key);
     void push_move();
 
     void init_new_move();
@@ -51,17 +67,18 @@ public:
     bool undo();
     bool redoo();
     std::string get_active_fen();
+    int count_repetitions(uint64_t key, int halfmove_clock);
 
     void write_PGN(path file_path);
 
     LogInstance *operator->();
 
     std::string starting_FEN = default_FEN;
+    uint64_t starting_key = 0;
     std::vector<LogInstance> move_history;
     LogInstance cur_move;
     int ply_index = -1;
 };
 
-std::ostream &operator<<(std::ostream &os, Move move);
 
 } // namespace Chess
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include "PerftCache.hpp"
+
+namespace Chess
+{
+
+PerftCache::PerftCache(size_t size_mb)
+{
+    // Round down to a power of two so the index is a mask of the hash
+    size_t nb_entries = 1;
+    while (nb_entries * 2 * sizeof(Entry) <= size_mb * 1024 * 1024) {
+        nb_entries *= 2;
+    }
+    entries = std::make_unique<Entry[]>(nb_entries);
+    mask = nb_entries - 1;
+    for (size_t i = 0; i < nb_entries; i++) {
+        entries[i].check.store(0, std::memory_order_relaxed);
+        entries[i].data.store(0, std::memory_order_relaxed);
+    }
+}
+
+bool PerftCache::probe(uint64_t hash, int depth, uint64_t &nodes, Stats *stats) const
+{
+    const Entry &entry = entries[hash & mask];
+    uint64_t data = entry.data.load(std::memory_order_relaxed);
+    uint64_t check = entry.check.load(std::memory_order_relaxed);
+
+    bool hit = (check ^ data) == hash && (int)(data & 0xFF) == depth;
+    if (stats) {
+        stats->probes += 1;
+        stats->hits += hit;
+    }
+    if (!hit) {
+        return false;
+    }
+    nodes = data >> 8;
+    return true;
+}
+
+void PerftCache::store(uint64_t hash, int depth, uint64_t nodes)
+{
+    Entry &entry = entries[hash & mask];
+    uint64_t data = (nodes << 8) | (depth & 0xFF);
+
+    entry.data.store(data, std::memory_order_relaxed);
+    entry.check.store(hash ^ data, std::memory_order_relaxed);
+}
+
+} // namespace Chess
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace Chess
+{
+
+// Fixed-size table of subtree node counts keyed by (zobrist hash, depth), shared between threads without locks.
+// Each entry stores its key XORed with its data: a torn write from two threads makes the key check fail,
+// so a corrupted entry is simply a miss.
+class PerftCache
+{
+public:
+    struct Stats {
+        uint64_t probes = 0;
+        uint64_t hits = 0;
+
+        inline void add(const Stats &other)
+        {
+            probes += other.probes;
+            hits += other.hits;
+        }
+    };
+
+    explicit PerftCache(size_t size_mb);
+
+    // stats may be null, nothing is counted then
+    bool probe(uint64_t hash, int depth, uint64_t &nodes, Stats *stats) const;
+    void store(uint64_t hash, int depth, uint64_t nodes);
+    inline size_t size() const { return mask + 1; }
+
+private:
+    struct Entry {
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> data; // Node count in the upper 56 bits, depth in the lower 8
+    };
+
+    std::unique_ptr<Entry[]> entries;
+    size_t mask;
+};
+
+} // namespace Chess
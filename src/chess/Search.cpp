@@ -0,0 +1,337 @@
+#include "Search.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace Chess
+{
+
+static constexpr int infinite_score = Search::mate_score + 1;
+// Scores beyond it are mates, stored in the table relative to the node instead of the root
+static constexpr int mate_bound = Search::mate_score - Search::max_ply;
+
+static int to_table(int score, int ply)
+{
+    return score > mate_bound ? score + ply : score < -mate_bound ? score - ply : score;
+}
+
+static int from_table(int score, int ply)
+{
+    return score > mate_bound ? score - ply : score < -mate_bound ? score + ply : score;
+}
+
+Search::Search(size_t hash_mb) : table(hash_mb)
+{
+    clear();
+}
+
+void Search::clear()
+{
+    table.clear();
+    std::fill(&killers[0][0], &killers[0][0] + max_ply * 2, Move(0, 0));
+    std::memset(history, 0, sizeof(history));
+}
+
+int Search::mate_in(int score)
+{
+    if (score > mate_bound) {
+        return (mate_score - score + 1) / 2;
+    }
+    if (score < -mate_bound) {
+        return -(mate_score + score + 1) / 2;
+    }
+    return 0;
+}
+
+std::string Search::format_score(int score)
+{
+    if (int moves = mate_in(score)) {
+        return "mate " + std::to_string(moves);
+    }
+    return "cp " + std::to_string(score);
+}
+
+SearchResult Search::run(Board &board, const SearchLimits &limits, const std::function<void(const SearchResult &)> &on_iteration)
+{
+    SearchResult result;
+    const int max_depth = limits.depth > 0 ? std::min(limits.depth, max_ply - 1) : max_ply - 1;
+
+    this->board = &board;
+    this->limits = limits;
+    start = std::chrono::steady_clock::now();
+    stopped = false;
+    nodes = 0;
+
+    // Every position of the game before the current one, the search then pushes the ones of its line
+    const MoveLog &log = board.move_history;
+    keys.assign(1, log.starting_key);
+    for (int ply = 0; ply <= log.ply_index; ply++) {
+        keys.push_back(log.move_history[ply].position_key);
+    }
+    if (keys.back() == board.zobrist_hash) {
+        keys.pop_back();
+    }
+    std::fill(&killers[0][0], &killers[0][0] + max_ply * 2, Move(0, 0));
+    // The history of earlier searches still helps, with less weight
+    for (auto &side : history) {
+        for (auto &from : side) {
+            for (auto &value : from) {
+                value /= 2;
+            }
+        }
+    }
+
+    // Something to play even if the first iteration gets interrupted
+    MoveList root_moves = board.get_all_legal_moves(board.is_white_turn);
+    if (root_moves.empty()) {
+        result.score = board.is_king_safe(board.is_white_turn) ? 0 : -mate_score;
+        return result;
+    }
+    result.best_move = root_moves[0];
+
+    for (int depth = 1; depth <= max_depth; depth++) {
+        int score = negamax(depth, 0, -infinite_score, infinite_score);
+        if (stopped) {
+            break;
+        }
+        result.best_move = pv[0][0];
+        result.score = score;
+        result.depth = depth;
+        result.pv.assign(pv[0], pv[0] + pv_length[0]);
+        result.nodes = nodes;
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (on_iteration) {
+            on_iteration(result);
+        }
+        // The next iteration would take longer than what is left, and nothing deeper than a forced mate matters
+        if (limits.time_ms && result.seconds * 1000 * 2 > limits.time_ms) {
+            break;
+        }
+        if (int moves = mate_in(score); moves && depth >= 2 * std::abs(moves)) {
+            break;
+        }
+    }
+    result.nodes = nodes;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+bool Search::should_stop()
+{
+    if (limits.nodes && nodes >= limits.nodes) {
+        stopped = true;
+    }
+    if (limits.time_ms && std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(limits.time_ms)) {
+        stopped = true;
+    }
+    return stopped;
+}
+
+// Any repetition inside the search is scored as a draw, the game rules wait for the third occurrence
+bool Search::is_draw() const
+{
+    if (board->halfmove_clock >= 100 || board->is_insufficient_material()) {
+        return true;
+    }
+    for (int back = 2; back <= board->halfmove_clock && back <= (int)keys.size(); back += 2) {
+        if (keys[keys.size() - back] == board->zobrist_hash) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int Search::evaluate() const
+{
+    return board->evaluate();
+}
+
+void Search::score_moves(const MoveList &moves, Move tt_move, int ply, int *scores) const
+{
+    const int side = color_of(board->is_white_turn);
+
+    for (size_t i = 0; i < moves.size(); i++) {
+        Move move = moves[i];
+        Piece::piece_type victim = move.is_en_passant() ? Piece::Pawn : board->type_at(move.end_pos());
+
+        if (move == tt_move) {
+            scores[i] = 1 << 30;
+        } else if (victim != Piece::NONE || move.promotion() != Piece::NONE) {
+            // Most valuable victim first, then least valuable attacker. Captures that lose material come after the quiet moves.
+            int order = (victim + 1) * 16 + (move.promotion() + 1) * 16 - board->type_at(move.start_pos());
+            scores[i] = board->see_ge(move, 0) ? (1 << 20) + order : -(1 << 20) + order;
+        } else if (move == killers[ply][0]) {
+            scores[i] = 1 << 19;
+        } else if (move == killers[ply][1]) {
+            scores[i] = 1 << 18;
+        } else {
+            scores[i] = history[side][move.start_pos()][move.end_pos()];
+        }
+    }
+}
+
+// Selection sort one step at a time, a cutoff usually comes before the list is sorted
+static Move pick_move(MoveList &moves, int *scores, size_t index)
+{
+    size_t best = index;
+
+    for (size_t i = index + 1; i < moves.size(); i++) {
+        if (scores[i] > scores[best]) {
+            best = i;
+        }
+    }
+    std::swap(moves[index], moves[best]);
+    std::swap(scores[index], scores[best]);
+    return moves[index];
+}
+
+int Search::negamax(int depth, int ply, int alpha, int beta)
+{
+    if (depth <= 0) {
+        return quiescence(ply, alpha, beta);
+    }
+    pv_length[ply] = ply;
+    if ((++nodes & 1023) == 0 && should_stop()) {
+        return 0;
+    }
+    if (ply > 0 && is_draw()) {
+        return 0;
+    }
+    if (ply >= max_ply - 1) {
+        return evaluate();
+    }
+
+    // Checks are searched one ply deeper
+    LegalityMasks masks = board->compute_legality_masks(board->is_white_turn);
+    bool in_check = masks.checkers != 0;
+    if (in_check) {
+        depth += 1;
+    }
+
+    const uint64_t hash = board->zobrist_hash;
+    Move tt_move(0, 0);
+    if (const TranspositionTable::Entry *entry = table.probe(hash)) {
+        tt_move = entry->move;
+        int score = from_table(entry->score, ply);
+        if (ply > 0 && entry->depth >= depth &&
+            (entry->bound == TranspositionTable::Exact || (entry->bound == TranspositionTable::Lower && score >= beta) ||
+             (entry->bound == TranspositionTable::Upper && score <= alpha))) {
+            return score;
+        }
+    }
+
+    MoveList moves;
+    board->generate_moves(board->is_white_turn, masks, AllMoves, ~0ULL, moves);
+    if (moves.empty()) {
+        return in_check ? -mate_score + ply : 0;
+    }
+    int scores[256];
+    score_moves(moves, tt_move, ply, scores);
+
+    const int original_alpha = alpha;
+    int best_score = -infinite_score;
+    Move best_move = moves[0];
+    keys.push_back(hash);
+    for (size_t i = 0; i < moves.size(); i++) {
+        Move move = pick_move(moves, scores, i);
+        bool is_quiet = board->type_at(move.end_pos()) == Piece::NONE && !move.is_en_passant() && move.promotion() == Piece::NONE;
+
+        UndoInfo undo = board->make_move(move);
+        int score = -negamax(depth - 1, ply + 1, -beta, -alpha);
+        board->unmake_move(undo);
+        if (stopped) {
+            keys.pop_back();
+            return 0;
+        }
+
+        if (score <= best_score) {
+            continue;
+        }
+        best_score = score;
+        best_move = move;
+        if (score <= alpha) {
+            continue;
+        }
+        alpha = score;
+        pv[ply][ply] = move;
+        std::copy(pv[ply + 1] + ply + 1, pv[ply + 1] + pv_length[ply + 1], pv[ply] + ply + 1);
+        pv_length[ply] = pv_length[ply + 1];
+        if (score >= beta) {
+            if (is_quiet) {
+                if (!(killers[ply][0] == move)) {
+                    killers[ply][1] = killers[ply][0];
+                    killers[ply][0] = move;
+                }
+                int &value = history[color_of(board->is_white_turn)][move.start_pos()][move.end_pos()];
+                value = std::min(value + depth * depth, (1 << 18) - 1);
+            }
+            break;
+        }
+    }
+    keys.pop_back();
+
+    TranspositionTable::Bound bound = best_score >= beta              ? TranspositionTable::Lower
+                                      : best_score > original_alpha ? TranspositionTable::Exact
+                                                                      : TranspositionTable::Upper;
+    table.store(hash, best_move, to_table(best_score, ply), depth, bound);
+    return best_score;
+}
+
+// Only captures and promotions that don't lose material, unless in check where every evasion is tried so mates are seen
+int Search::quiescence(int ply, int alpha, int beta)
+{
+    pv_length[ply] = ply;
+    if ((++nodes & 1023) == 0 && should_stop()) {
+        return 0;
+    }
+    if (ply >= max_ply - 1) {
+        return evaluate();
+    }
+
+    LegalityMasks masks = board->compute_legality_masks(board->is_white_turn);
+    bool in_check = masks.checkers != 0;
+    int best_score = -infinite_score;
+    if (!in_check) {
+        best_score = evaluate();
+        if (best_score >= beta) {
+            return best_score;
+        }
+        alpha = std::max(alpha, best_score);
+    }
+
+    MoveList moves;
+    board->generate_moves(board->is_white_turn, masks, in_check ? AllMoves : Captures, ~0ULL, moves);
+    if (in_check && moves.empty()) {
+        return -mate_score + ply;
+    }
+    int scores[256];
+    score_moves(moves, Move(0, 0), ply, scores);
+
+    for (size_t i = 0; i < moves.size(); i++) {
+        Move move = pick_move(moves, scores, i);
+        // Sorted last, so every capture left loses material too
+        if (!in_check && scores[i] < 0) {
+            break;
+        }
+
+        UndoInfo undo = board->make_move(move);
+        int score = -quiescence(ply + 1, -beta, -alpha);
+        board->unmake_move(undo);
+        if (stopped) {
+            return 0;
+        }
+        if (score > best_score) {
+            best_score = score;
+            if (score > alpha) {
+                alpha = score;
+                if (score >= beta) {
+                    break;
+                }
+            }
+        }
+    }
+    return best_score;
+}
+
+} // namespace Chess
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "TranspositionTable.hpp"
+#include "board.hpp"
+
+namespace Chess
+{
+
+// A limit of 0 is no limit, the search stops at the first one reached
+struct SearchLimits {
+    int depth = 0;
+    uint64_t nodes = 0;
+    int time_ms = 0;
+};
+
+struct SearchResult {
+    Move best_move = Move(0, 0); // Move(0, 0) when the side to move has no legal move
+    int score = 0;               // Centipawns from the side to move, see Search::mate_in for mates
+    int depth = 0;               // Last depth searched to the end
+    uint64_t nodes = 0;
+    double seconds = 0;
+    std::vector<Move> pv;
+
+    inline uint64_t nps() const { return seconds > 0 ? nodes / seconds : 0; }
+};
+
+// Negamax alpha-beta with iterative deepening and a quiescence search on captures. Moves are tried in the order
+// transposition table move, captures by most valuable victim, killer moves, quiet moves by history, then the captures
+// the static exchange evaluation finds losing, which the quiescence search skips.
+class Search
+{
+public:
+    static constexpr int max_ply = 64;
+    static constexpr int mate_score = 32000;
+
+    explicit Search(size_t hash_mb = 16);
+
+    // The board is back to its position when it returns. Repetitions of the game in board.move_history count as draws.
+    // on_iteration is called after every depth searched to the end.
+    SearchResult run(Board &board, const SearchLimits &limits, const std::function<void(const SearchResult &)> &on_iteration = nullptr);
+    // Forgets the transposition table, killers and history of the previous searches
+    void clear();
+
+    // Moves until mate, negative when the side to move gets mated, 0 when the score isn't a mate
+    static int mate_in(int score);
+    // "cp 35" or "mate -3"
+    static std::string format_score(int score);
+
+private:
+    int negamax(int depth, int ply, int alpha, int beta);
+    int quiescence(int ply, int alpha, int beta);
+    int evaluate() const;
+    bool is_draw() const;
+    void score_moves(const MoveList &moves, Move tt_move, int ply, int *scores) const;
+    bool should_stop();
+
+    Board *board = nullptr;
+    SearchLimits limits;
+    std::chrono::steady_clock::time_point start;
+    bool stopped = false;
+    uint64_t nodes = 0;
+
+    TranspositionTable table;
+    std::vector<uint64_t> keys; // Positions of the game then of the current line, for the repetition rule
+    Move killers[max_ply][2];
+    int history[2][64][64];
+    Move pv[max_ply][max_ply];
+    int pv_length[max_ply];
+};
+
+} // namespace Chess
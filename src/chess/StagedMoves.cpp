@@ -0,0 +1,35 @@
+#include "StagedMoves.hpp"
+
+namespace Chess
+{
+
+StagedMoves::StagedMoves(Board &board, Bitboard origins, gen_type stages)
+    : board(board), masks(board.compute_legality_masks(board.is_white_turn)), origins(origins),
+      next_stage(stages == Quiets ? Quiets : Captures), last_stage(stages == Captures ? Captures : Quiets)
+{
+}
+
+StagedMoves::iterator StagedMoves::begin()
+{
+    fill();
+    return iterator(this);
+}
+
+void StagedMoves::advance()
+{
+    index += 1;
+    fill();
+}
+
+// Generates the following stages until one of them has moves or none are left
+void StagedMoves::fill()
+{
+    while (index == moves.size() && next_stage <= last_stage) {
+        moves.clear();
+        index = 0;
+        board.generate_moves(board.is_white_turn, masks, next_stage, origins, moves);
+        next_stage = (gen_type)(next_stage + 1);
+    }
+}
+
+} // namespace Chess
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+
+#include "board.hpp"
+
+namespace Chess
+{
+
+// Legal moves of the side to move, generated lazily one stage at a time: captures and promotions first, then the others.
+// A stage is only generated once iteration reaches it, and only for the pieces standing on origins.
+// It is a single pass input range (std::generator isn't available yet); the board must not change while iterating.
+class StagedMoves
+{
+public:
+    class iterator
+    {
+    public:
+        using value_type = Move;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+        explicit iterator(StagedMoves *staged) : staged(staged) {}
+
+        inline Move operator*() const { return staged->moves[staged->index]; }
+        inline iterator &operator++()
+        {
+            staged->advance();
+            return *this;
+        }
+        inline void operator++(int) { staged->advance(); }
+        inline bool operator==(std::default_sentinel_t) const { return staged->index == staged->moves.size(); }
+
+    private:
+        StagedMoves *staged = nullptr;
+    };
+
+    // stages is Captures or Quiets to only generate that stage
+    StagedMoves(Board &board, Bitboard origins = ~0ULL, gen_type stages = AllMoves);
+
+    iterator begin();
+    inline std::default_sentinel_t end() const { return std::default_sentinel; }
+
+private:
+    void advance();
+    void fill();
+
+    Board &board;
+    LegalityMasks masks;
+    Bitboard origins;
+    gen_type next_stage;
+    gen_type last_stage;
+    MoveList moves;
+    size_t index = 0;
+};
+
+} // namespace Chess
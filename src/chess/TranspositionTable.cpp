@@ -0,0 +1,42 @@
+#include "TranspositionTable.hpp"
+
+namespace Chess
+{
+
+TranspositionTable::TranspositionTable(size_t size_mb)
+{
+    // Round down to a power of two so the index is a mask of the hash
+    size_t nb_entries = 1;
+    while (nb_entries * 2 * sizeof(Entry) <= size_mb * 1024 * 1024) {
+        nb_entries *= 2;
+    }
+    entries = std::make_unique<Entry[]>(nb_entries);
+    mask = nb_entries - 1;
+}
+
+const TranspositionTable::Entry *TranspositionTable::probe(uint64_t hash) const
+{
+    const Entry &entry = entries[hash & mask];
+
+    return entry.bound != None && entry.key == hash ? &entry : nullptr;
+}
+
+void TranspositionTable::store(uint64_t hash, Move move, int score, int depth, Bound bound)
+{
+    Entry &entry = entries[hash & mask];
+
+    entry.key = hash;
+    entry.move = move;
+    entry.score = score;
+    entry.depth = depth;
+    entry.bound = bound;
+}
+
+void TranspositionTable::clear()
+{
+    for (size_t i = 0; i <= mask; i++) {
+        entries[i] = Entry();
+    }
+}
+
+} // namespace Chess
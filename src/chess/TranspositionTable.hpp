@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "move.hpp"
+
+namespace Chess
+{
+
+// Fixed-size table of search results keyed by zobrist hash, one entry per slot and always replaced.
+// Owned by a single search, so unlike PerftCache the entries are plain memory.
+class TranspositionTable
+{
+public:
+    enum Bound : uint8_t { None, Exact, Lower, Upper };
+
+    struct Entry {
+        uint64_t key = 0;
+        Move move = Move(0, 0);
+        int16_t score = 0;
+        int8_t depth = 0;
+        Bound bound = None;
+    };
+
+    explicit TranspositionTable(size_t size_mb);
+
+    // nullptr when the position isn't stored
+    const Entry *probe(uint64_t hash) const;
+    void store(uint64_t hash, Move move, int score, int depth, Bound bound);
+    void clear();
+    inline size_t size() const { return mask + 1; }
+
+private:
+    std::unique_ptr<Entry[]> entries;
+    size_t mask;
+};
+
+} // namespace Chess
@@ -0,0 +1,152 @@
+#include "attack_maps.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define HAS_X86_KERNELS
+#endif
+
+namespace Chess
+{
+namespace bitboard
+{
+
+// Squares a slider may come from after a one square shift, so that fills never wrap around the board
+constexpr Bitboard not_file_a = ~file_a;
+constexpr Bitboard not_file_h = ~file_h;
+
+// Every square reached from gen by sliding through empty squares (pro), then one more step onto the blocker.
+// Three doubling steps cover the 7 squares of the longest ray.
+template <int Shift, Bitboard Wrap> static inline Bitboard fill_left(Bitboard gen, Bitboard empty)
+{
+    Bitboard pro = empty & Wrap;
+    gen |= pro & (gen << Shift);
+    pro &= pro << Shift;
+    gen |= pro & (gen << 2 * Shift);
+    pro &= pro << 2 * Shift;
+    gen |= pro & (gen << 4 * Shift);
+    return (gen << Shift) & Wrap;
+}
+
+template <int Shift, Bitboard Wrap> static inline Bitboard fill_right(Bitboard gen, Bitboard empty)
+{
+    Bitboard pro = empty & Wrap;
+    gen |= pro & (gen >> Shift);
+    pro &= pro >> Shift;
+    gen |= pro & (gen >> 2 * Shift);
+    pro &= pro >> 2 * Shift;
+    gen |= pro & (gen >> 4 * Shift);
+    return (gen >> Shift) & Wrap;
+}
+
+static inline Bitboard scalar_attack_map(const SliderSet &set)
+{
+    Bitboard empty = ~set.occupied;
+
+    return fill_left<8, ~0ULL>(set.orthogonals, empty) | fill_right<8, ~0ULL>(set.orthogonals, empty)
+        | fill_left<1, not_file_a>(set.orthogonals, empty) | fill_right<1, not_file_h>(set.orthogonals, empty)
+        | fill_left<9, not_file_a>(set.diagonals, empty) | fill_right<9, not_file_h>(set.diagonals, empty)
+        | fill_left<7, not_file_h>(set.diagonals, empty) | fill_right<7, not_file_a>(set.diagonals, empty);
+}
+
+void slider_attack_maps_scalar(const SliderSet *sets, size_t count, Bitboard *attacks)
+{
+    for (size_t i = 0; i < count; i++) {
+        attacks[i] = scalar_attack_map(sets[i]);
+    }
+}
+
+#ifdef HAS_X86_KERNELS
+
+// Lanes, lowest first: north, east, north east and north west when shifting left, south, west, south west and south
+// east when shifting right. Both use the same shift amounts, only the wrap masks differ.
+__attribute__((target("avx2"))) static inline Bitboard avx2_attack_map(const SliderSet &set)
+{
+    const __m256i shift = _mm256_set_epi64x(7, 9, 1, 8);
+    const __m256i shift_2 = _mm256_add_epi64(shift, shift);
+    const __m256i shift_4 = _mm256_add_epi64(shift_2, shift_2);
+    const __m256i left_wrap = _mm256_set_epi64x(not_file_h, not_file_a, not_file_a, ~0ULL);
+    const __m256i right_wrap = _mm256_set_epi64x(not_file_a, not_file_h, not_file_h, ~0ULL);
+    __m256i empty = _mm256_set1_epi64x(~set.occupied);
+    __m256i gen = _mm256_set_epi64x(set.diagonals, set.diagonals, set.orthogonals, set.orthogonals);
+
+    __m256i left = gen;
+    __m256i pro = _mm256_and_si256(empty, left_wrap);
+    left = _mm256_or_si256(left, _mm256_and_si256(pro, _mm256_sllv_epi64(left, shift)));
+    pro = _mm256_and_si256(pro, _mm256_sllv_epi64(pro, shift));
+    left = _mm256_or_si256(left, _mm256_and_si256(pro, _mm256_sllv_epi64(left, shift_2)));
+    pro = _mm256_and_si256(pro, _mm256_sllv_epi64(pro, shift_2));
+    left = _mm256_or_si256(left, _mm256_and_si256(pro, _mm256_sllv_epi64(left, shift_4)));
+    left = _mm256_and_si256(_mm256_sllv_epi64(left, shift), left_wrap);
+
+    __m256i right = gen;
+    pro = _mm256_and_si256(empty, right_wrap);
+    right = _mm256_or_si256(right, _mm256_and_si256(pro, _mm256_srlv_epi64(right, shift)));
+    pro = _mm256_and_si256(pro, _mm256_srlv_epi64(pro, shift));
+    right = _mm256_or_si256(right, _mm256_and_si256(pro, _mm256_srlv_epi64(right, shift_2)));
+    pro = _mm256_and_si256(pro, _mm256_srlv_epi64(pro, shift_2));
+    right = _mm256_or_si256(right, _mm256_and_si256(pro, _mm256_srlv_epi64(right, shift_4)));
+    right = _mm256_and_si256(_mm256_srlv_epi64(right, shift), right_wrap);
+
+    // OR the four directions together
+    __m256i all = _mm256_or_si256(left, right);
+    __m128i half = _mm_or_si128(_mm256_castsi256_si128(all), _mm256_extracti128_si256(all, 1));
+    return _mm_cvtsi128_si64(_mm_or_si128(half, _mm_unpackhi_epi64(half, half)));
+}
+
+__attribute__((target("avx2"))) void slider_attack_maps_avx2(const SliderSet *sets, size_t count, Bitboard *attacks)
+{
+    for (size_t i = 0; i < count; i++) {
+        attacks[i] = avx2_attack_map(sets[i]);
+    }
+}
+
+bool cpu_has_avx2()
+{
+    // Needed when called before main, the libgcc constructor that fills the CPU model may not have run yet
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+#else
+
+void slider_attack_maps_avx2(const SliderSet *sets, size_t count, Bitboard *attacks)
+{
+    slider_attack_maps_scalar(sets, count, attacks);
+}
+
+bool cpu_has_avx2()
+{
+    return false;
+}
+
+#endif
+
+typedef void (*SliderKernel)(const SliderSet *sets, size_t count, Bitboard *attacks);
+
+// Picked on first use rather than by a static initializer, so the static initializers of other files can use it
+static SliderKernel slider_kernel()
+{
+    static const SliderKernel kernel = cpu_has_avx2() ? slider_attack_maps_avx2 : slider_attack_maps_scalar;
+    return kernel;
+}
+
+void slider_attack_maps(const SliderSet *sets, size_t count, Bitboard *attacks)
+{
+    slider_kernel()(sets, count, attacks);
+}
+
+Bitboard slider_attack_map(const SliderSet &set)
+{
+    Bitboard attacks;
+
+    slider_kernel()(&set, 1, &attacks);
+    return attacks;
+}
+
+const char *slider_kernel_name()
+{
+    return slider_kernel() == slider_attack_maps_avx2 ? "avx2" : "scalar";
+}
+
+} // namespace bitboard
+} // namespace Chess
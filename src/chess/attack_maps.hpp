@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+
+#include "bitboard.hpp"
+
+namespace Chess
+{
+namespace bitboard
+{
+
+// One side's sliders in one position, queens belong to both sets
+struct SliderSet {
+    Bitboard orthogonals;
+    Bitboard diagonals;
+    Bitboard occupied;
+};
+
+// Union of the squares attacked by the sliders of each set, with Kogge-Stone occluded fills instead of one lookup per
+// piece. The AVX2 kernel fills the four directions that shift left in one register and their opposites in another,
+// it is picked once at startup when the CPU supports it, the scalar kernel otherwise.
+void slider_attack_maps(const SliderSet *sets, size_t count, Bitboard *attacks);
+Bitboard slider_attack_map(const SliderSet &set);
+const char *slider_kernel_name();
+
+// The kernels themselves, so benchmarks can compare them. The AVX2 one must only be called when the CPU has AVX2.
+void slider_attack_maps_scalar(const SliderSet *sets, size_t count, Bitboard *attacks);
+void slider_attack_maps_avx2(const SliderSet *sets, size_t count, Bitboard *attacks);
+bool cpu_has_avx2();
+
+} // namespace bitboard
+} // namespace Chess
@@ -0,0 +1,239 @@
+#include "bitboard.hpp"
+
+#include <cstddef>
+
+namespace Chess
+{
+namespace bitboard
+{
+
+typedef std::array<Bitboard, 64> SquareTable;
+
+static constexpr Bitboard rook_magic_numbers[64] = {
+    0x0080068051e04000ULL, 0x0040001000402000ULL, 0x0080100020008008ULL, 0x4e000a0010208440ULL,
+    0x4200040802002010ULL, 0x0100010008020400ULL, 0x9080608019000600ULL, 0x8100020080204100ULL,
+    0x4103800480400020ULL, 0x8015004004802100ULL, 0x000200108a002040ULL, 0x0801000821001000ULL,
+    0x0015000500080070ULL, 0x0120800400800200ULL, 0x0109000432001100ULL, 0x020080055b000080ULL,
+    0x0080004000402002ULL, 0x5260848020004008ULL, 0x2402020014402080ULL, 0x3000808010000802ULL,
+    0x0304018004810800ULL, 0x0000808004000200ULL, 0x0002040001500248ULL, 0x0012020000408401ULL,
+    0x8440008080004020ULL, 0x0804200840100040ULL, 0x0820008080201000ULL, 0x2080100100082100ULL,
+    0x0001000500100800ULL, 0x00a1000900028400ULL, 0x0100100400c80102ULL, 0x000001120000a044ULL,
+    0x800080c004800620ULL, 0x4040081000202000ULL, 0x0d08802008801000ULL, 0x1000800800801004ULL,
+    0x1004000801010010ULL, 0x0402800400800200ULL, 0x0004080204008110ULL, 0x0000404082000401ULL,
+    0x00c0118861408000ULL, 0x1100220081020048ULL, 0x09a0430420050010ULL, 0x0000082200420010ULL,
+    0x2110080004008080ULL, 0x2004201040680104ULL, 0x1106001451820008ULL, 0x0002224104820014ULL,
+    0x00800c8044210500ULL, 0x02a0200040100040ULL, 0x040100a0001e4100ULL, 0x00204023108a0200ULL,
+    0x2400080080040080ULL, 0x1289008400020900ULL, 0x0002088250010400ULL, 0x0001006084010200ULL,
+    0x0001023480002141ULL, 0x0006400021810015ULL, 0x8400100840200101ULL, 0x40003000a1000825ULL,
+    0x1002011008200402ULL, 0x100d000400080201ULL, 0x0020048806102904ULL, 0x8401000020804201ULL,
+};
+
+static constexpr Bitboard bishop_magic_numbers[64] = {
+    0x4c40240122060016ULL, 0x8048110404004a80ULL, 0x8004440410414020ULL, 0x021c410060405000ULL,
+    0x80cd1040d0480812ULL, 0x0002021104000082ULL, 0x08440082a8200001ULL, 0x00202a0800841002ULL,
+    0x0200c40810842088ULL, 0x60c0081000c08901ULL, 0x00a3d0040042510cULL, 0x1c00110400808541ULL,
+    0x0400820211084005ULL, 0x0000008860080800ULL, 0x002002020202c000ULL, 0x0400344e08040a81ULL,
+    0x812800102098a080ULL, 0x00202010823a2040ULL, 0x4086400800830201ULL, 0x5008012a22004000ULL,
+    0x0004801c00a00000ULL, 0x0000400200505400ULL, 0x0480408401080820ULL, 0x8000400029082824ULL,
+    0x0008880804501000ULL, 0x0001600048084100ULL, 0x0108220624040400ULL, 0x0008080000820002ULL,
+    0xc804040010410041ULL, 0x01080a0040208400ULL, 0x2018030480a88800ULL, 0x4040410020410810ULL,
+    0x1108044010100210ULL, 0x084a100400029800ULL, 0x0801080100820c00ULL, 0x8010400808108200ULL,
+    0x0084008400020500ULL, 0x0002004200290481ULL, 0x0010150200032090ULL, 0x8404042220404102ULL,
+    0x0302080308004008ULL, 0x1200420820000408ULL, 0x0802002024200800ULL, 0x4020824208000084ULL,
+    0x000002020c008200ULL, 0x2c40208081000882ULL, 0x2082223441000401ULL, 0x8804080081101020ULL,
+    0x4401011002220808ULL, 0x81020c4202100000ULL, 0x4005004404040308ULL, 0x0820400c42020001ULL,
+    0x0020206421820010ULL, 0x0150401001424008ULL, 0x02a20242020c0608ULL, 0x5020110109011200ULL,
+    0x2050840108410401ULL, 0x0100090880842108ULL, 0x220008960142187aULL, 0x1111028880208820ULL,
+    0x4400200042028200ULL, 0x4400010802084206ULL, 0x0000400242040100ULL, 0x0002201104010944ULL,
+};
+
+// (rank, file) steps, in the order of the Direction enum
+static constexpr int direction_steps[8][2] = {{1, 0}, {0, 1}, {1, 1}, {1, -1}, {-1, 0}, {0, -1}, {-1, -1}, {-1, 1}};
+static constexpr int knight_steps[8][2] = {{2, 1}, {-2, -1}, {2, -1}, {-2, 1}, {1, 2}, {-1, -2}, {1, -2}, {-1, 2}};
+static constexpr int white_pawn_steps[2][2] = {{1, -1}, {1, 1}};
+static constexpr int black_pawn_steps[2][2] = {{-1, -1}, {-1, 1}};
+
+static constexpr Direction rook_directions[4] = {North, East, South, West};
+static constexpr Direction bishop_directions[4] = {NorthEast, NorthWest, SouthWest, SouthEast};
+
+static constexpr bool is_on_board(int rank, int file)
+{
+    return rank >= 0 && rank < 8 && file >= 0 && file < 8;
+}
+
+static constexpr SquareTable make_step_attacks(const int (*steps)[2], int nb_steps)
+{
+    SquareTable table = {};
+
+    for (int square = 0; square < 64; square++) {
+        for (int i = 0; i < nb_steps; i++) {
+            int rank = square / 8 + steps[i][0];
+            int file = square % 8 + steps[i][1];
+            if (is_on_board(rank, file)) {
+                table[square] |= square_bb(rank * 8 + file);
+            }
+        }
+    }
+    return table;
+}
+
+// Plain arrays: unlike std::array subscripts they don't cost a function call each in constant evaluation
+struct RayTable {
+    Bitboard bb[8][64];
+};
+
+static constexpr RayTable make_rays()
+{
+    RayTable rays = {};
+
+    for (int direction = North; direction <= SouthEast; direction++) {
+        for (int square = 0; square < 64; square++) {
+            int rank = square / 8 + direction_steps[direction][0];
+            int file = square % 8 + direction_steps[direction][1];
+            while (is_on_board(rank, file)) {
+                rays.bb[direction][square] |= square_bb(rank * 8 + file);
+                rank += direction_steps[direction][0];
+                file += direction_steps[direction][1];
+            }
+        }
+    }
+    return rays;
+}
+
+constexpr SquareTable knight_attacks = make_step_attacks(knight_steps, 8);
+constexpr SquareTable king_attacks = make_step_attacks(direction_steps, 8);
+constexpr std::array<SquareTable, 2> pawn_attacks = {make_step_attacks(white_pawn_steps, 2), make_step_attacks(black_pawn_steps, 2)};
+static constexpr RayTable ray_table = make_rays();
+
+static constexpr std::array<SquareTable, 8> make_ray_bb()
+{
+    std::array<SquareTable, 8> rays = {};
+
+    for (int direction = North; direction <= SouthEast; direction++) {
+        for (int square = 0; square < 64; square++) {
+            rays[direction][square] = ray_table.bb[direction][square];
+        }
+    }
+    return rays;
+}
+
+constexpr std::array<SquareTable, 8> ray_bb = make_ray_bb();
+
+static constexpr Direction opposite(int direction)
+{
+    return (Direction)((direction + 4) % 8);
+}
+
+static constexpr std::array<SquareTable, 64> make_between()
+{
+    std::array<SquareTable, 64> between = {};
+
+    for (int a = 0; a < 64; a++) {
+        for (int direction = North; direction <= SouthEast; direction++) {
+            Bitboard ray = ray_bb[direction][a];
+            while (ray) {
+                int b = pop_lsb(ray);
+                between[a][b] = ray_bb[direction][a] & ~ray_bb[direction][b] & ~square_bb(b);
+            }
+        }
+    }
+    return between;
+}
+
+static constexpr std::array<SquareTable, 64> make_lines()
+{
+    std::array<SquareTable, 64> lines = {};
+
+    for (int a = 0; a < 64; a++) {
+        for (int direction = North; direction <= SouthEast; direction++) {
+            Bitboard ray = ray_bb[direction][a];
+            while (ray) {
+                lines[a][pop_lsb(ray)] = ray_bb[direction][a] | ray_bb[opposite(direction)][a] | square_bb(a);
+            }
+        }
+    }
+    return lines;
+}
+
+constexpr std::array<SquareTable, 64> between_bb = make_between();
+constexpr std::array<SquareTable, 64> line_bb = make_lines();
+
+// Attacks along one ray stop at the nearest blocker, which is included
+static constexpr Bitboard ray_attacks(int direction, int square, Bitboard occupied)
+{
+    Bitboard attacks = ray_table.bb[direction][square];
+    Bitboard blockers = attacks & occupied;
+
+    if (blockers) {
+        int blocker = direction < South ? lsb(blockers) : 63 - __builtin_clzll(blockers);
+        attacks ^= ray_table.bb[direction][blocker];
+    }
+    return attacks;
+}
+
+// Unrolled, the compiler has a budget of operations for evaluating each table
+static constexpr Bitboard sliding_attacks(int square, Bitboard occupied, const Direction *directions)
+{
+    return ray_attacks(directions[0], square, occupied) | ray_attacks(directions[1], square, occupied)
+        | ray_attacks(directions[2], square, occupied) | ray_attacks(directions[3], square, occupied);
+}
+
+// Every square's magic and the attack sets of all its relevant occupancies, packed one square after the other
+template <std::size_t TableSize> struct SliderTables {
+    Magic magics[64] = {};
+    unsigned offsets[64] = {};
+    Bitboard attacks[TableSize] = {};
+};
+
+template <std::size_t TableSize> static constexpr SliderTables<TableSize> make_slider_tables(const Bitboard *magic_numbers, const Direction *directions)
+{
+    SliderTables<TableSize> tables;
+    unsigned offset = 0;
+
+    for (int square = 0; square < 64; square++) {
+        // Border squares never block anything, so they are not part of the relevant occupancy
+        Bitboard edges = ((rank_1 | rank_8) & ~(rank_1 << (square / 8 * 8))) | ((file_a | file_h) & ~(file_a << (square % 8)));
+        Magic &m = tables.magics[square];
+
+        m.mask = sliding_attacks(square, 0, directions) & ~edges;
+        m.magic = magic_numbers[square];
+        m.shift = 64 - count(m.mask);
+        tables.offsets[square] = offset;
+
+        // Carry-Rippler trick to enumerate every subset of the mask, in increasing pext order
+        Bitboard occupied = 0;
+        unsigned subset = 0;
+        do {
+#ifdef __BMI2__
+            unsigned index = subset;
+#else
+            unsigned index = ((occupied & m.mask) * m.magic) >> m.shift;
+#endif
+            tables.attacks[offset + index] = sliding_attacks(square, occupied, directions);
+            occupied = (occupied - m.mask) & m.mask;
+            subset += 1;
+        } while (occupied);
+        offset += 1U << count(m.mask);
+    }
+    return tables;
+}
+
+template <std::size_t TableSize> static constexpr std::array<Magic, 64> link_magics(const SliderTables<TableSize> &tables)
+{
+    std::array<Magic, 64> magics = {};
+
+    for (int square = 0; square < 64; square++) {
+        magics[square] = tables.magics[square];
+        magics[square].attacks = &tables.attacks[tables.offsets[square]];
+    }
+    return magics;
+}
+
+static constexpr auto rook_tables = make_slider_tables<0x19000>(rook_magic_numbers, rook_directions);
+static constexpr auto bishop_tables = make_slider_tables<0x1480>(bishop_magic_numbers, bishop_directions);
+
+constexpr std::array<Magic, 64> rook_magics = link_magics(rook_tables);
+constexpr std::array<Magic, 64> bishop_magics = link_magics(bishop_tables);
+
+} // namespace bitboard
+} // namespace Chess
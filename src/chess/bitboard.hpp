@@ -0,0 +1,149 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#ifdef __BMI2__
+    #include <immintrin.h>
+#endif
+
+namespace Chess
+{
+
+typedef uint64_t Bitboard;
+
+enum Color { White = 0, Black = 1 };
+
+constexpr Color color_of(bool is_white)
+{
+    return is_white ? White : Black;
+}
+
+namespace bitboard
+{
+
+constexpr Bitboard file_a = 0x0101010101010101ULL;
+constexpr Bitboard file_h = file_a << 7;
+constexpr Bitboard rank_1 = 0xFFULL;
+constexpr Bitboard rank_3 = rank_1 << 16;
+constexpr Bitboard rank_6 = rank_1 << 40;
+constexpr Bitboard rank_8 = rank_1 << 56;
+
+constexpr Bitboard square_bb(int square)
+{
+    return 1ULL << square;
+}
+
+constexpr int lsb(Bitboard b)
+{
+    return __builtin_ctzll(b);
+}
+
+constexpr int pop_lsb(Bitboard &b)
+{
+    int square = lsb(b);
+    b &= b - 1;
+    return square;
+}
+
+constexpr int count(Bitboard b)
+{
+    return __builtin_popcountll(b);
+}
+
+// Shifts a whole set one rank/file, dropping squares that would wrap around the board
+constexpr Bitboard north(Bitboard b)
+{
+    return b << 8;
+}
+
+constexpr Bitboard south(Bitboard b)
+{
+    return b >> 8;
+}
+
+constexpr Bitboard north_east(Bitboard b)
+{
+    return (b & ~file_h) << 9;
+}
+
+constexpr Bitboard north_west(Bitboard b)
+{
+    return (b & ~file_a) << 7;
+}
+
+constexpr Bitboard south_east(Bitboard b)
+{
+    return (b & ~file_h) >> 7;
+}
+
+constexpr Bitboard south_west(Bitboard b)
+{
+    return (b & ~file_a) >> 9;
+}
+
+// Pawn pushes and captures towards the opponent's side, Us is known at compile time
+template <Color Us> constexpr Bitboard pawn_push(Bitboard b)
+{
+    return Us == White ? north(b) : south(b);
+}
+
+template <Color Us> constexpr Bitboard pawn_east_attacks(Bitboard b)
+{
+    return Us == White ? north_east(b) : south_east(b);
+}
+
+template <Color Us> constexpr Bitboard pawn_west_attacks(Bitboard b)
+{
+    return Us == White ? north_west(b) : south_west(b);
+}
+
+// Positive directions come first: the nearest blocker on their rays is the lowest set bit, on the others the highest
+enum Direction { North, East, NorthEast, NorthWest, South, West, SouthWest, SouthEast };
+
+struct Magic {
+    Bitboard mask;
+    Bitboard magic;
+    const Bitboard *attacks;
+    int shift;
+
+    inline unsigned index(Bitboard occupied) const
+    {
+#ifdef __BMI2__
+        return _pext_u64(occupied, mask);
+#else
+        return ((occupied & mask) * magic) >> shift;
+#endif
+    }
+};
+
+// All generated at compile time and shared read-only by every board
+extern const std::array<Bitboard, 64> knight_attacks;
+extern const std::array<Bitboard, 64> king_attacks;
+extern const std::array<std::array<Bitboard, 64>, 2> pawn_attacks;
+extern const std::array<std::array<Bitboard, 64>, 8> ray_bb;      // [direction][square], squares up to the border
+extern const std::array<std::array<Bitboard, 64>, 64> between_bb; // Squares strictly between two aligned squares, 0 if not aligned
+extern const std::array<std::array<Bitboard, 64>, 64> line_bb;    // Whole rank/file/diagonal through two aligned squares, 0 if not aligned
+extern const std::array<Magic, 64> rook_magics;
+extern const std::array<Magic, 64> bishop_magics;
+
+inline Bitboard rook_attacks(int square, Bitboard occupied)
+{
+    const Magic &m = rook_magics[square];
+    return m.attacks[m.index(occupied)];
+}
+
+inline Bitboard bishop_attacks(int square, Bitboard occupied)
+{
+    const Magic &m = bishop_magics[square];
+    return m.attacks[m.index(occupied)];
+}
+
+inline Bitboard queen_attacks(int square, Bitboard occupied)
+{
+    return rook_attacks(square, occupied) | bishop_attacks(square, occupied);
+}
+
+} // namespace bitboard
+
+} // namespace Chess
@@ -1,939 +1,1124 @@
 #include "board.hpp"
 
+#include "StagedMoves.hpp"
+#include "evaluation.hpp"
+#include "zobrist.hpp"
+
 #include <algorithm>
-#include <cmath>
+#include <cstdlib>
 #include <iostream>
-#include <set>
-#include <stdexcept>
 
 using namespace Chess;
 
-Board::Board()
-{
-    precompute_distance_to_borders();
-}
-
-Chess::Board::~Board()
-{
-    free(this->promotion_popup);
-}
-
-void Chess::Board::move_piece(Move move)
-{
-    full_board[move.end_pos] = full_board[move.start_pos];
-    full_board[move.end_pos].indexed_position = move.end_pos;
-    full_board[move.start_pos] = Piece();
-    if (move.promotion != Piece::piece_type::NONE) {
-        full_board[move.end_pos].type = move.promotion;
-    }
-}
-
-void Board::play_move(Move move)
+// Everything that depends on the side to move is resolved at compile time, the non-template overloads dispatch once on it
+template <Color Us> UndoInfo Board::make_move(Move move)
 {
-    bool is_capture = full_board[move.end_pos].type != Piece::NONE;
-    auto &moving_piece = full_board[move.start_pos];
-
-    move_history->move = move;
-    move_history->piece = moving_piece;
-    move_history->isCapture = is_capture;
-
-    if (is_capture || moving_piece.type == Piece::Pawn) {
+    constexpr Color Them = Us == White ? Black : White;
+    constexpr int forward = Us == White ? 8 : -8;
+    int start_pos = move.start_pos();
+    int end_pos = move.end_pos();
+    UndoInfo undo;
+
+    undo.move = move;
+    undo.moved_type = type_at(start_pos);
+    undo.captured_type = type_at(end_pos);
+    undo.captured_square = end_pos;
+    undo.king_white_castle = king_white_castle;
+    undo.queen_white_castle = queen_white_castle;
+    undo.king_black_castle = king_black_castle;
+    undo.queen_black_castle = queen_black_castle;
+    undo.en_passant_square = en_passant_square;
+    undo.halfmove_clock = halfmove_clock;
+    undo.fullmove_number = fullmove_number;
+    undo.zobrist_hash = zobrist_hash;
+
+    // Castling rights and en passant are hashed out here and back in once they are updated, the en passant key depends on
+    // the pawns and the side to move so it is read before any of them change
+    zobrist_hash ^= castling_hash() ^ en_passant_hash();
+
+    if (undo.captured_type != Piece::NONE || undo.moved_type == Piece::Pawn) {
         halfmove_clock = 0;
     } else {
         halfmove_clock += 1;
     }
 
-    if (is_white_turn == false) {
+    if constexpr (Us == Black) {
         fullmove_number += 1;
     }
 
     // Check for en passant to capture pawn
-    if (moving_piece.type == Piece::Pawn && move.end_pos == en_passant_square) {
-        move_history->isCapture = true;
-        if (moving_piece.is_white) {
-            full_board[move.end_pos - 8] = Piece();
-        } else {
-            full_board[move.end_pos + 8] = Piece();
-        }
+    if (move.is_en_passant()) {
+        undo.captured_type = Piece::Pawn;
+        undo.captured_square = end_pos - forward;
+    }
+    if (undo.captured_type != Piece::NONE) {
+        remove_piece(Them == White, undo.captured_type, undo.captured_square);
     }
+    remove_piece(Us == White, undo.moved_type, start_pos);
+    add_piece(Us == White, move.promotion() != Piece::NONE ? move.promotion() : undo.moved_type, end_pos);
 
     // Check for castling
-    if (moving_piece.type == Piece::King) {
-        if (moving_piece.is_white) {
-            if (move.start_pos == 4 && move.end_pos == 6) {
-                move_piece(Move(7, 5));
-                move_history->isCastle = true;
-            }
-            if (move.start_pos == 4 && move.end_pos == 2) {
-                move_piece(Move(0, 3));
-                move_history->isCastle = true;
-            }
-        } else {
-            if (move.start_pos == 60 && move.end_pos == 62) {
-                move_piece(Move(63, 61));
-                move_history->isCastle = true;
-            }
-            if (move.start_pos == 60 && move.end_pos == 58) {
-                move_piece(Move(56, 59));
-                move_history->isCastle = true;
-            }
-        }
+    if (move.is_castle()) {
+        bool is_king_side = end_pos > start_pos;
+        remove_piece(Us == White, Piece::Rook, is_king_side ? start_pos + 3 : start_pos - 4);
+        add_piece(Us == White, Piece::Rook, is_king_side ? start_pos + 1 : start_pos - 1);
     }
 
     en_passant_square = -1;
-    if (moving_piece.type == Piece::Pawn && abs(move.start_pos - move.end_pos) == 16) {
-        if (is_white_turn) {
-            en_passant_square = move.start_pos + 8;
-        } else {
-            en_passant_square = move.start_pos - 8;
-        }
+    if (undo.moved_type == Piece::Pawn && end_pos - start_pos == 2 * forward) {
+        en_passant_square = start_pos + forward;
     }
 
-    if (!is_mini_board) {
-        check_if_move_voids_castle(move, moving_piece);
-    }
+    check_if_move_voids_castle(move);
+    is_white_turn = Us == Black;
+    zobrist_hash ^= castling_hash() ^ en_passant_hash() ^ zobrist::side;
 
-    for (auto &potential_move : legal_moves) {
-        if (potential_move.start_pos == move.start_pos) {
-            continue;
-        }
-        auto potential_piece = full_board[potential_move.start_pos];
-        if (potential_move.end_pos == move.end_pos && potential_piece.type == moving_piece.type) {
-            if (move.start_pos % 8 == potential_move.start_pos % 8) { // If there is a matching file, show the rank
-                move_history->showRank = true;
-            } else { // If there is not matching file, show the file (if nothing matches priority for the file)
-                move_history->showFile = true;
-            }
-        }
-    }
-
-    move_piece(move);
-
-    bool is_check = !is_king_safe(!is_white_turn);
-
-    is_white_turn = !is_white_turn;
+    return undo;
+}
 
-    if (log_FEN) {
-        std::cout << get_FEN() << std::endl;
-    }
-    if (!is_mini_board) {
-        this->legal_moves = get_all_legal_moves(is_white_turn);
-        move_history->isCheck = is_check;
-        move_history->isMate = is_check && legal_moves.size() == 0;
-        move_history->fen = get_FEN();
-        move_history->isDraw = !is_check && legal_moves.size() == 0;
-        move_history.push_move();
-        show_last_move();
-    }
+UndoInfo Board::make_move(Move move)
+{
+    return is_white_turn ? make_move<White>(move) : make_move<Black>(move);
 }
 
-void Board::check_if_move_voids_castle(Move move, Piece &moving_piece)
+// Us is the side that played the move being undone
+template <Color Us> void Board::unmake_move(const UndoInfo &undo)
 {
-    auto &captured_piece = full_board[move.end_pos];
+    constexpr Color Them = Us == White ? Black : White;
+    Move move = undo.move;
+    int start_pos = move.start_pos();
+    int end_pos = move.end_pos();
 
-    if (moving_piece.type == Piece::King) {
-        if (is_white_turn) {
-            king_white_castle = false;
-            queen_white_castle = false;
-        } else {
-            king_black_castle = false;
-            queen_black_castle = false;
-        }
-    }
+    is_white_turn = Us == White;
 
-    if (moving_piece.type == Piece::Rook) {
-        int rank = moving_piece.indexed_position / 8;
-        int file = moving_piece.indexed_position % 8;
-        bool is_on_starting_rank = rank == (is_white_turn ? 0 : 7);
-        if (file == 0 && is_on_starting_rank) {
-            if (is_white_turn) {
-                queen_white_castle = false;
-            } else {
-                queen_black_castle = false;
-            }
-        }
-        if (file == 7 && is_on_starting_rank) {
-            if (is_white_turn) {
-                king_white_castle = false;
-            } else {
-                king_black_castle = false;
-            }
-        }
+    remove_piece(Us == White, move.promotion() != Piece::NONE ? move.promotion() : undo.moved_type, end_pos);
+    add_piece(Us == White, undo.moved_type, start_pos);
+    if (undo.captured_type != Piece::NONE) {
+        add_piece(Them == White, undo.captured_type, undo.captured_square);
     }
 
-    if (captured_piece.type == Piece::Rook) {
-        int rank = moving_piece.indexed_position / 8;
-        int file = moving_piece.indexed_position % 8;
-        bool is_on_starting_rank = rank == (is_white_turn ? 7 : 0);
-        if (file == 0 && is_on_starting_rank) {
-            if (is_white_turn) {
-                queen_black_castle = false;
-            } else {
-                queen_white_castle = false;
-            }
-        }
-        if (file == 7 && is_on_starting_rank) {
-            if (is_white_turn) {
-                king_black_castle = false;
-            } else {
-                king_white_castle = false;
-            }
-        }
+    if (move.is_castle()) {
+        bool is_king_side = end_pos > start_pos;
+        remove_piece(Us == White, Piece::Rook, is_king_side ? start_pos + 1 : start_pos - 1);
+        add_piece(Us == White, Piece::Rook, is_king_side ? start_pos + 3 : start_pos - 4);
     }
+
+    king_white_castle = undo.king_white_castle;
+    queen_white_castle = undo.queen_white_castle;
+    king_black_castle = undo.king_black_castle;
+    queen_black_castle = undo.queen_black_castle;
+    en_passant_square = undo.en_passant_square;
+    halfmove_clock = undo.halfmove_clock;
+    fullmove_number = undo.fullmove_number;
+    zobrist_hash = undo.zobrist_hash;
 }
 
-void Board::setup_textures(std::filesystem::path path, RessourceManager *manager)
+void Board::unmake_move(const UndoInfo &undo)
 {
-    this->manager = manager;
-    this->promotion_popup = new PromotionPopup();
-    setup_board_textures(path);
+    if (is_white_turn) {
+        unmake_move<Black>(undo);
+    } else {
+        unmake_move<White>(undo);
+    }
 }
 
-void Board::setup_board_textures(std::filesystem::path path)
+void Board::play_move(Move move)
 {
-    if (!this->texture.loadFromFile(path)) {
-        throw std::runtime_error("SFML board error");
+    LogInstance &entry = move_history.cur_move;
+
+    move = with_flags(move);
+    describe_move(move, entry);
+    entry.undo = make_move(move);
+    if (log_FEN) {
+        std::cout << get_FEN() << std::endl;
     }
-    this->sprite.setTexture(this->texture);
-    scale_board();
+    describe_result(entry, move_history.count_repetitions(zobrist_hash, halfmove_clock));
+    entry.score = is_white_turn ? evaluate() : -evaluate();
+    entry.fen = get_FEN();
+    entry.position_key = zobrist_hash;
+    move_history.push_move();
 }
 
-void Board::setup_pieces_textures()
+// What the SAN of a legal move needs to know before it is played
+void Board::describe_move(Move move, LogInstance &entry)
 {
+    Piece moving_piece = piece_at(move.start_pos());
+
+    entry.move = move;
+    entry.piece = moving_piece;
+    entry.isCapture = piece_at(move.end_pos()).type != Piece::NONE || move.is_en_passant();
+    entry.isCastle = move.is_castle();
+    entry.showRank = false;
+    entry.showFile = false;
+
+    // Only the other pieces of the same type can make the move ambiguous
+    Bitboard same_type = pieces(moving_piece.is_white, moving_piece.type) & ~bitboard::square_bb(move.start_pos());
+    for (auto potential_move : StagedMoves(*this, same_type)) {
+        if (potential_move.end_pos() == move.end_pos()) {
+            if (move.start_pos() % 8 == potential_move.start_pos() % 8) { // If there is a matching file, show the rank
+                entry.showRank = true;
+            } else { // If there is not matching file, show the file (if nothing matches priority for the file)
+                entry.showFile = true;
+            }
+        }
+    }
 }
 
-Piece::piece_type type_from_char(char c)
+// Check, mate and draws once the move is played, repetitions being the number of earlier occurrences of the position
+void Board::describe_result(LogInstance &entry, int repetitions)
 {
-    switch (tolower(c)) {
-    case 'k':
-        return Piece::piece_type::King;
-    case 'q':
-        return Piece::piece_type::Queen;
-    case 'r':
-        return Piece::piece_type::Rook;
-    case 'b':
-        return Piece::piece_type::Bishop;
-    case 'n':
-        return Piece::piece_type::Knight;
-    default:
-    case 'p':
-        return Piece::piece_type::Pawn;
+    bool is_check = !is_king_safe(is_white_turn);
+
+    // The first legal move found is enough to rule out mate and stalemate
+    StagedMoves next_moves(*this);
+    bool has_legal_moves = next_moves.begin() != next_moves.end();
+    entry.isCheck = is_check;
+    entry.isMate = is_check && !has_legal_moves;
+    entry.draw_reason = LogInstance::NoDraw;
+    if (entry.isMate) {
+        entry.draw_reason = LogInstance::NoDraw;
+    } else if (!has_legal_moves) {
+        entry.draw_reason = LogInstance::Stalemate;
+    } else if (halfmove_clock >= 100) {
+        entry.draw_reason = LogInstance::FiftyMoves;
+    } else if (is_insufficient_material()) {
+        entry.draw_reason = LogInstance::InsufficientMaterial;
+    } else if (repetitions >= 2) {
+        entry.draw_reason = LogInstance::Repetition;
     }
+    entry.isDraw = entry.draw_reason != LogInstance::NoDraw;
 }
 
-bool Board::load_from_FEN_board(std::string fen_board)
+bool Board::undo_move()
 {
-    int file = 0;
-    int rank = 7;
-    for (char symbol : fen_board) {
-        if (symbol == '/') {
-            file = 0;
-            rank -= 1;
-        } else {
-            if (isdigit(symbol)) {
-                file += symbol - '0';
-            } else {
-                bool is_white = isupper(symbol);
-                auto type = type_from_char(symbol);
-                int pos = rank * 8 + file;
-
-                this->add_piece(is_white, type, pos);
-                file += 1;
-            }
-        }
+    if (move_history.ply_index == -1) {
+        return false;
     }
+    unmake_move(move_history.move_history[move_history.ply_index].undo);
+    move_history.undo();
     return true;
 }
 
-bool Board::load_from_FEN_color(std::string fen_color)
+bool Board::redo_move()
 {
-    if (fen_color.size() == 1) {
-        if (fen_color[0] == 'w') {
-            is_white_turn = true;
-        } else if (fen_color[0] == 'b') {
-            is_white_turn = false;
-        } else {
-            return false;
-        }
-    } else {
+    if (!move_history.redoo()) {
         return false;
     }
+    make_move(move_history.move_history[move_history.ply_index].move);
     return true;
 }
 
-bool Board::load_from_FEN_castle(std::string fen_castle)
+// Whatever leaves or lands on a king or rook starting square (the king or rook moving, a rook being captured) voids
+// the castles that depend on it, whichever side played
+void Board::check_if_move_voids_castle(Move move)
 {
-    king_black_castle = false;
-    king_white_castle = false;
-    queen_black_castle = false;
-    queen_white_castle = false;
+    Bitboard touched = bitboard::square_bb(move.start_pos()) | bitboard::square_bb(move.end_pos());
 
-    for (auto c : fen_castle) {
-        switch (c) {
-        case 'K':
-            king_white_castle = true;
-            break;
-        case 'Q':
-            queen_white_castle = true;
-            break;
-        case 'k':
-            king_black_castle = true;
-            break;
-        case 'q':
-            queen_black_castle = true;
-            break;
-        }
+    if (touched & (bitboard::square_bb(4) | bitboard::square_bb(7))) {
+        king_white_castle = false;
+    }
+    if (touched & (bitboard::square_bb(4) | bitboard::square_bb(0))) {
+        queen_white_castle = false;
+    }
+    if (touched & (bitboard::square_bb(60) | bitboard::square_bb(63))) {
+        king_black_castle = false;
+    }
+    if (touched & (bitboard::square_bb(60) | bitboard::square_bb(56))) {
+        queen_black_castle = false;
     }
-
-    return true;
 }
 
-bool Board::load_from_FEN_en_passant(std::string fen_en_passant)
+bool Board::load_from_FEN(std::string_view FEN)
 {
-    if (fen_en_passant == "-") {
-        en_passant_square = -1;
-        return true;
-    }
-    if (fen_en_passant.size() != 2) {
-        return false;
-    }
-    int file = fen_en_passant[0] - 'a';
-    int rank = fen_en_passant[1] - '1';
+    FenPosition position;
 
-    if (file > 7 || file < 0 || rank < 0 || rank > 7) {
+    if (FenError error = parse_FEN(FEN, position)) {
+        std::cerr << "Invalid fen: \"" << FEN << "\" (" << error.message() << " at column " << error.offset + 1 << ")" << std::endl;
         return false;
     }
-    en_passant_square = rank * 8 + file;
+    set_position(position);
     return true;
 }
 
-bool Board::load_from_FEN_half_move(std::string fen_half_move)
+void Board::set_position(const FenPosition &position)
 {
-    try {
-        halfmove_clock = std::stoi(fen_half_move);
-        return true;
-    } catch (std::invalid_argument const &e) {
-        halfmove_clock = 0;
-        return false;
+    for (auto &bb : by_type) {
+        bb = 0;
+    }
+    by_color[White] = 0;
+    by_color[Black] = 0;
+    king_squares[White] = -1;
+    king_squares[Black] = -1;
+    psq_mg = 0;
+    psq_eg = 0;
+    phase = 0;
+    if (network) {
+        nnue::refresh(*network, *this, accumulator); // Only the biases on the empty board
+    }
+
+    for (int color = White; color <= Black; color++) {
+        for (int type = Piece::Pawn; type <= Piece::King; type++) {
+            Bitboard bb = position.by_type[type] & position.by_color[color];
+            while (bb) {
+                add_piece(color == White, (Piece::piece_type)type, bitboard::pop_lsb(bb));
+            }
+        }
+    }
+    is_white_turn = position.is_white_turn;
+    king_white_castle = position.king_white_castle;
+    queen_white_castle = position.queen_white_castle;
+    king_black_castle = position.king_black_castle;
+    queen_black_castle = position.queen_black_castle;
+    en_passant_square = position.en_passant_square;
+    halfmove_clock = position.halfmove_clock;
+    fullmove_number = position.fullmove_number;
+
+    zobrist_hash = compute_hash();
+    if (log_FEN) {
+        std::cout << get_FEN() << std::endl;
     }
 }
-bool Board::load_from_FEN_full_move(std::string fen_full_move)
+
+uint64_t Board::castling_hash() const
 {
-    try {
-        fullmove_number = std::stoi(fen_full_move);
-        return true;
-    } catch (std::invalid_argument const &e) {
-        fullmove_number = 0;
-        return false;
-    }
+    return (king_white_castle ? zobrist::castling[0] : 0) ^ (queen_white_castle ? zobrist::castling[1] : 0)
+        ^ (king_black_castle ? zobrist::castling[2] : 0) ^ (queen_black_castle ? zobrist::castling[3] : 0);
 }
 
-bool Board::load_from_FEN(std::string FEN)
+// Only when a pawn of the side to move attacks the square, so that a position right after a double push is the same as
+// its repetitions when the pawn can't be taken anyway
+uint64_t Board::en_passant_hash() const
 {
-    for (int i = 0; i < 64; i++) {
-        full_board[i] = Piece();
+    if (en_passant_square == -1) {
+        return 0;
     }
-
-    int nb_spaces = std::count(FEN.begin(), FEN.end(), ' ');
-
-    if (nb_spaces > 5 || nb_spaces < 3) {
-        std::cerr << "Invalid fen: \"" << FEN << "\"" << std::endl;
-        return false;
+    if (!(bitboard::pawn_attacks[color_of(!is_white_turn)][en_passant_square] & pieces(is_white_turn, Piece::Pawn))) {
+        return 0;
     }
+    return zobrist::en_passant[en_passant_square % 8];
+}
 
-    std::stringstream ss(FEN);
-
-    std::string fen_board;
-    std::string fen_color;
-    std::string fen_castling;
-    std::string fen_en_passant;
-    std::string fen_half_move;
-    std::string fen_full_move;
-
-    ss >> fen_board;
-    ss >> fen_color;
-    ss >> fen_castling;
-    ss >> fen_en_passant;
-    ss >> fen_half_move;
-    ss >> fen_full_move;
-
-    if (load_from_FEN_board(fen_board) && load_from_FEN_color(fen_color) && load_from_FEN_castle(fen_castling)
-        && load_from_FEN_en_passant(fen_en_passant)) {
-    } else {
-        std::cerr << "Invalid fen: \"" << FEN << "\"" << std::endl;
-        return false;
-    }
+// Full recomputation, the hash is otherwise kept up to date incrementally by add_piece/remove_piece and make_move
+uint64_t Board::compute_hash() const
+{
+    uint64_t hash = castling_hash() ^ en_passant_hash() ^ (is_white_turn ? 0 : zobrist::side);
 
-    halfmove_clock = 0;
-    fullmove_number = 0;
-    if (nb_spaces >= 4 && !load_from_FEN_half_move(fen_half_move)) {
-        std::cerr << "Half_move_error" << std::endl;
-        std::cerr << "Invalid fen: \"" << FEN << "\"" << std::endl;
-        return false;
-    }
-    if (nb_spaces >= 5 && !load_from_FEN_full_move(fen_full_move)) {
-        std::cerr << "Full_move_error" << std::endl;
-        std::cerr << "Invalid fen: \"" << FEN << "\"" << std::endl;
-        return false;
+    for (int color = White; color <= Black; color++) {
+        for (int type = Piece::Pawn; type <= Piece::King; type++) {
+            Bitboard bb = by_type[type] & by_color[color];
+            while (bb) {
+                hash ^= zobrist::pieces[color][type][bitboard::pop_lsb(bb)];
+            }
+        }
     }
+    return hash;
+}
 
-    if (log_FEN) {
-        std::cout << get_FEN() << std::endl;
-    }
-    if (!is_mini_board) {
-        legal_moves = get_all_legal_moves(is_white_turn);
+static char *write_number(char *out, int value)
+{
+    char digits[10];
+    int nb_digits = 0;
+
+    do {
+        digits[nb_digits++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+    while (nb_digits > 0) {
+        *out++ = digits[--nb_digits];
     }
-
-    return true;
+    return out;
 }
 
-std::string Board::get_FEN()
+// buffer must hold at least max_FEN_length characters, the FEN is null terminated and its length returned
+size_t Board::write_FEN(char *buffer) const
 {
-    std::string FEN;
+    static const char piece_chars[2][6] = {{'P', 'N', 'B', 'R', 'Q', 'K'}, {'p', 'n', 'b', 'r', 'q', 'k'}};
+    Bitboard occ = occupied();
+    char *out = buffer;
+
     for (int rank = 7; rank >= 0; rank -= 1) {
-        int numEmptyFiles = 0;
+        int nb_empty_files = 0;
         for (int file = 0; file < 8; file += 1) {
-            int i = rank * 8 + file;
-            auto &piece = full_board[i];
-            if (piece.type != Piece::NONE) {
-                if (numEmptyFiles != 0) {
-                    FEN += std::to_string(numEmptyFiles);
-                    numEmptyFiles = 0;
-                }
-                int pieceType = piece.type;
-                char pieceChar = ' ';
-                switch (pieceType) {
-                case Piece::Rook:
-                    pieceChar = 'R';
-                    break;
-                case Piece::Knight:
-                    pieceChar = 'N';
-                    break;
-                case Piece::Bishop:
-                    pieceChar = 'B';
-                    break;
-                case Piece::Queen:
-                    pieceChar = 'Q';
-                    break;
-                case Piece::King:
-                    pieceChar = 'K';
-                    break;
-                case Piece::Pawn:
-                    pieceChar = 'P';
-                    break;
-                }
-                FEN += piece.is_white ? pieceChar : tolower(pieceChar);
-            } else {
-                numEmptyFiles += 1;
+            Bitboard bb = bitboard::square_bb(rank * 8 + file);
+            if (!(occ & bb)) {
+                nb_empty_files += 1;
+                continue;
+            }
+            if (nb_empty_files != 0) {
+                *out++ = '0' + nb_empty_files;
+                nb_empty_files = 0;
             }
+            int type = Piece::Pawn;
+            while (!(by_type[type] & bb)) {
+                type++;
+            }
+            *out++ = piece_chars[(by_color[White] & bb) ? White : Black][type];
         }
-        if (numEmptyFiles != 0) {
-            FEN += std::to_string(numEmptyFiles);
+        if (nb_empty_files != 0) {
+            *out++ = '0' + nb_empty_files;
         }
         if (rank != 0) {
-            FEN += "/";
+            *out++ = '/';
         }
     }
 
-    FEN = FEN + " " + (is_white_turn ? "w" : "b");
+    *out++ = ' ';
+    *out++ = is_white_turn ? 'w' : 'b';
 
-    FEN += " ";
+    *out++ = ' ';
     // If no castle is possible
     if ((king_white_castle || king_black_castle || queen_white_castle || queen_black_castle) == false) {
-        FEN += "-";
+        *out++ = '-';
     } else {
         if (king_white_castle) {
-            FEN += "K";
+            *out++ = 'K';
         }
         if (queen_white_castle) {
-            FEN += "Q";
+            *out++ = 'Q';
         }
         if (king_black_castle) {
-            FEN += "k";
+            *out++ = 'k';
         }
         if (queen_black_castle) {
-            FEN += "q";
+            *out++ = 'q';
         }
     }
 
-    FEN += " ";
+    *out++ = ' ';
     if (en_passant_square == -1) {
-        FEN += "-";
+        *out++ = '-';
     } else {
-        FEN += Move::get_clean_coordinate(en_passant_square);
+        *out++ = 'a' + en_passant_square % 8;
+        *out++ = '1' + en_passant_square / 8;
     }
-    FEN = FEN + " " + std::to_string(halfmove_clock) + " " + std::to_string(fullmove_number);
+    *out++ = ' ';
+    out = write_number(out, halfmove_clock);
+    *out++ = ' ';
+    out = write_number(out, fullmove_number);
+    *out = '\0';
+
+    return out - buffer;
+}
 
-    return FEN;
+std::string Board::get_FEN() const
+{
+    char buffer[max_FEN_length];
+    size_t length = write_FEN(buffer);
+
+    return std::string(buffer, length);
 }
 
 void Board::print_all_legal_moves()
 {
-    for (auto &move : legal_moves) {
+    for (auto &move : get_all_legal_moves(is_white_turn)) {
         std::cout << move << std::endl;
     }
 }
 
-int Board::get_square_from_mouse(sf::Vector2i local_position)
+void Board::add_piece(bool is_white, Piece::piece_type type, int indexed_pos)
 {
-    sf::Vector2f board_location = {local_position.x - get_origin().x, local_position.y - get_origin().y};
-
-    int true_x = std::floor(board_location.x / square_size);
-    int true_y = std::floor(board_location.y / -square_size);
-    if (true_x < 8 && true_x >= 0 && true_y < 8 && true_y >= 0) {
-        return true_y * 8 + true_x;
-    } else {
-        return -1;
+    Bitboard bb = bitboard::square_bb(indexed_pos);
+    by_type[type] |= bb;
+    by_color[color_of(is_white)] |= bb;
+    zobrist_hash ^= zobrist::pieces[color_of(is_white)][type][indexed_pos];
+    psq_mg += evaluation::psq.scores[color_of(is_white)][type][indexed_pos].mg;
+    psq_eg += evaluation::psq.scores[color_of(is_white)][type][indexed_pos].eg;
+    phase += evaluation::phase_weights[type];
+    if (network) {
+        nnue::add_piece(*network, accumulator, color_of(is_white), type, indexed_pos);
+    }
+    if (type == Piece::King) {
+        king_squares[color_of(is_white)] = indexed_pos;
     }
 }
 
-void Chess::Board::resize_board(unsigned width, unsigned height)
+void Board::remove_piece(int indexed_pos)
 {
-    square_size = std::min(width, height) / 8;
-    scale_board();
-    scale_pieces();
-    this->promotion_popup->scale(*this);
+    Bitboard bb = bitboard::square_bb(indexed_pos);
+
+    if (!(occupied() & bb)) {
+        return;
+    }
+    Color color = (by_color[White] & bb) ? White : Black;
+    for (int type = Piece::Pawn; type <= Piece::King; type++) {
+        if (by_type[type] & bb) {
+            by_type[type] ^= bb;
+            zobrist_hash ^= zobrist::pieces[color][type][indexed_pos];
+            psq_mg -= evaluation::psq.scores[color][type][indexed_pos].mg;
+            psq_eg -= evaluation::psq.scores[color][type][indexed_pos].eg;
+            phase -= evaluation::phase_weights[type];
+            if (network) {
+                nnue::remove_piece(*network, accumulator, color, (Piece::piece_type)type, indexed_pos);
+            }
+            break;
+        }
+    }
+    by_color[color] ^= bb;
+    if (king_squares[White] == indexed_pos) {
+        king_squares[White] = -1;
+    } else if (king_squares[Black] == indexed_pos) {
+        king_squares[Black] = -1;
+    }
 }
 
-void Chess::Board::scale_board()
+// Cheaper than remove_piece(int) when the piece on the square is already known
+void Board::remove_piece(bool is_white, Piece::piece_type type, int indexed_pos)
 {
-    float scale = square_size * 8.f / this->texture.getSize().x;
-    this->sprite.setScale(scale, scale);
-
-    this->highlighted_square_shape.setSize({(float)square_size, (float)square_size});
-    this->main_highlighted_square_shape.setSize({(float)square_size, (float)square_size});
-    this->highlighted_square_shape.setFillColor(sf::Color(255, 0, 0, 100));
-    this->main_highlighted_square_shape.setFillColor(sf::Color(255, 100, 0, 100));
+    Bitboard bb = bitboard::square_bb(indexed_pos);
+
+    by_type[type] ^= bb;
+    by_color[color_of(is_white)] ^= bb;
+    zobrist_hash ^= zobrist::pieces[color_of(is_white)][type][indexed_pos];
+    psq_mg -= evaluation::psq.scores[color_of(is_white)][type][indexed_pos].mg;
+    psq_eg -= evaluation::psq.scores[color_of(is_white)][type][indexed_pos].eg;
+    phase -= evaluation::phase_weights[type];
+    if (network) {
+        nnue::remove_piece(*network, accumulator, color_of(is_white), type, indexed_pos);
+    }
+    if (type == Piece::King) {
+        king_squares[color_of(is_white)] = -1;
+    }
 }
 
-void Board::scale_pieces()
+void Board::set_network(const nnue::Network *network)
 {
-    for (int i = 0; i < 12; i++) {
-        sf::Vector2u size = manager->sprite_piece_array[i].getTexture()->getSize();
-        manager->sprite_piece_array[i].setScale((float)square_size / size.x, (float)square_size / size.y);
+    this->network = network;
+    if (network) {
+        nnue::refresh(*network, *this, accumulator);
     }
 }
 
-sf::Vector2f Board::get_origin()
+int Board::evaluate() const
 {
-    return this->sprite.getPosition() + sf::Vector2f(0, square_size * 8);
+    return network ? nnue::evaluate(*network, accumulator, is_white_turn) : evaluation::evaluate(*this);
 }
 
-void Board::add_piece(bool is_white, Piece::piece_type type, int indexed_pos)
+Piece::piece_type Board::type_at(int indexed_pos) const
 {
-    Piece piece(is_white, type, indexed_pos);
-    full_board[indexed_pos] = piece;
+    Bitboard bb = bitboard::square_bb(indexed_pos);
+
+    if (!(occupied() & bb)) {
+        return Piece::NONE;
+    }
+    int type = Piece::Pawn;
+    while (!(by_type[type] & bb)) {
+        type++;
+    }
+    return (Piece::piece_type)type;
 }
 
-bool Chess::Board::is_square_safe(int square, bool cur_is_white)
+Piece Board::piece_at(int indexed_pos) const
 {
-    std::vector theorical_moves = get_all_legal_moves(!cur_is_white);
-    for (auto &move : theorical_moves) {
-        if (move.end_pos == square) {
-            return false;
+    Bitboard bb = bitboard::square_bb(indexed_pos);
+    if (!(occupied() & bb)) {
+        return Piece();
+    }
+    for (int type = Piece::Pawn; type <= Piece::King; type++) {
+        if (by_type[type] & bb) {
+            return Piece(by_color[White] & bb, (Piece::piece_type)type, indexed_pos);
         }
     }
-    return true;
+    return Piece();
 }
 
-bool Chess::Board::is_king_safe(bool cur_is_white)
+Bitboard Board::attacked_squares(bool by_white, Bitboard occ) const
 {
-    int king_square = -1;
+    Bitboard pawns = pieces(by_white, Piece::Pawn);
+    Bitboard result = by_white ? bitboard::north_east(pawns) | bitboard::north_west(pawns) : bitboard::south_east(pawns) | bitboard::south_west(pawns);
 
-    for (int i = 0; i < 64; i++) {
-        auto &cur_piece = full_board[i];
-        if (cur_piece.type == Piece::King && cur_piece.is_white == cur_is_white) {
-            king_square = i;
-            break;
-        }
+    Bitboard knights = pieces(by_white, Piece::Knight);
+    while (knights) {
+        result |= bitboard::knight_attacks[bitboard::pop_lsb(knights)];
     }
-    if (king_square == -1) {
-        return true;
+    result |= bitboard::slider_attack_map(sliders(by_white, occ));
+    Bitboard kings = pieces(by_white, Piece::King);
+    while (kings) {
+        result |= bitboard::king_attacks[bitboard::pop_lsb(kings)];
     }
-    return is_square_safe(king_square, cur_is_white);
+    return result;
 }
 
-void Chess::Board::show_last_move()
+bitboard::SliderSet Board::sliders(bool is_white, Bitboard occ) const
 {
-    auto &last_move = move_history.move_history.back();
-    std::cout << last_move.print_move() << std::endl;
+    Bitboard queens = pieces(is_white, Piece::Queen);
+
+    return {pieces(is_white, Piece::Rook) | queens, pieces(is_white, Piece::Bishop) | queens, occ};
 }
 
-std::vector<Move> Board::get_all_legal_moves(bool is_mover_white)
+Bitboard Board::attackers_to(int square, Bitboard occ) const
 {
-    std::vector<Move> result;
-    for (int i = 0; i < 64; i++) {
-        auto &piece = full_board[i];
-        if (is_mover_white != piece.is_white) {
-            continue;
-        }
-        if (piece.type == Piece::Rook || piece.type == Piece::Bishop || piece.type == Piece::Queen) {
-            add_sliding_moves(piece, result);
-        } else if (piece.type == Piece::Knight) {
-            add_knight_moves(piece, result);
-        } else if (piece.type == Piece::Pawn) {
-            add_pawn_moves(piece, result);
-        } else if (piece.type == Piece::King) {
-            add_king_moves(piece, result);
+    Bitboard diagonals = by_type[Piece::Bishop] | by_type[Piece::Queen];
+    Bitboard orthogonals = by_type[Piece::Rook] | by_type[Piece::Queen];
+
+    return (bitboard::pawn_attacks[White][square] & pieces(false, Piece::Pawn))
+        | (bitboard::pawn_attacks[Black][square] & pieces(true, Piece::Pawn))
+        | (bitboard::knight_attacks[square] & by_type[Piece::Knight]) | (bitboard::king_attacks[square] & by_type[Piece::King])
+        | (bitboard::bishop_attacks(square, occ) & diagonals) | (bitboard::rook_attacks(square, occ) & orthogonals);
+}
+
+// The sliders that see the square once the pieces already used in the exchange are gone from occ
+Bitboard Board::xray_attackers(int square, Bitboard occ) const
+{
+    return ((bitboard::bishop_attacks(square, occ) & (by_type[Piece::Bishop] | by_type[Piece::Queen]))
+            | (bitboard::rook_attacks(square, occ) & (by_type[Piece::Rook] | by_type[Piece::Queen])))
+        & occ;
+}
+
+// Sets type to the least valuable piece among attackers, none when there is no attacker
+static Bitboard least_valuable_attacker(const Board &board, Bitboard attackers, Piece::piece_type &type)
+{
+    for (int candidate = Piece::Pawn; candidate <= Piece::King; candidate++) {
+        if (Bitboard bb = attackers & board.by_type[candidate]) {
+            type = (Piece::piece_type)candidate;
+            return bb & -bb;
         }
     }
-    if (is_mini_board) {
-        return result;
-    }
+    return 0;
+}
 
-    // Filter for checks
-    Board mini_board;
-    mini_board.log_FEN = false;
-    mini_board.is_mini_board = true;
-    std::string base_fen = get_FEN();
-
-    auto it = result.begin();
-    while (it != result.end()) {
-        mini_board.load_from_FEN(base_fen);
-        mini_board.play_move(*it);
-        if (!mini_board.is_king_safe(is_mover_white)) {
-            it = result.erase(it);
-        } else {
-            it++;
+// Swap list: gain[depth] is what the side making capture depth wins if the exchange stopped after it, then the list is
+// folded back from the end with each side free to stop capturing
+int Board::see(Move move) const
+{
+    if (move.is_castle()) {
+        return 0;
+    }
+    const int to = move.end_pos();
+    Bitboard from_bb = bitboard::square_bb(move.start_pos());
+    Bitboard occ = occupied();
+    Piece::piece_type attacker = type_at(move.start_pos());
+    bool is_white = by_color[White] & from_bb;
+    Piece::piece_type captured = move.is_en_passant() ? Piece::Pawn : type_at(to);
+    int gain[32];
+    int depth = 0;
+
+    gain[0] = captured == Piece::NONE ? 0 : see_values[captured];
+    if (move.is_en_passant()) {
+        occ ^= bitboard::square_bb(is_white ? to - 8 : to + 8);
+    }
+    if (move.promotion() != Piece::NONE) {
+        gain[0] += see_values[move.promotion()] - see_values[Piece::Pawn];
+        attacker = move.promotion();
+    }
+    Bitboard attackers = attackers_to(to, occ);
+    while (true) {
+        depth++;
+        gain[depth] = see_values[attacker] - gain[depth - 1];
+        occ ^= from_bb;
+        attackers = (attackers | xray_attackers(to, occ)) & occ;
+        is_white = !is_white;
+        from_bb = least_valuable_attacker(*this, attackers & by_color[color_of(is_white)], attacker);
+        // The king can only take last, as in see_ge
+        if (!from_bb || (attacker == Piece::King && (attackers & by_color[color_of(!is_white)]))) {
+            break;
         }
     }
-
-    return result;
+    while (--depth) {
+        gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+    }
+    return gain[0];
 }
 
-void Board::add_knight_moves(Piece &piece, std::vector<Move> &moves)
+// swap is what the side to capture next has to win back for the threshold to be missed, result whether it is met if
+// that side cannot or does not want to capture
+bool Board::see_ge(Move move, int threshold) const
 {
-    int x = piece.indexed_position % 8;
-    int y = piece.indexed_position / 8;
+    if (move.is_castle()) {
+        return threshold <= 0;
+    }
+    const int from = move.start_pos();
+    const int to = move.end_pos();
+    bool is_white = by_color[White] & bitboard::square_bb(from);
+    Piece::piece_type captured = move.is_en_passant() ? Piece::Pawn : type_at(to);
+    Piece::piece_type moved = move.promotion() != Piece::NONE ? move.promotion() : type_at(from);
+    int swap = (captured == Piece::NONE ? 0 : see_values[captured]) - threshold;
+
+    if (move.promotion() != Piece::NONE) {
+        swap += see_values[move.promotion()] - see_values[Piece::Pawn];
+    }
+    if (swap < 0) {
+        return false;
+    }
+    swap = see_values[moved] - swap;
+    if (swap <= 0) {
+        return true;
+    }
 
-    const std::pair<int, int> knight_moves[8] = {
-        std::pair(2, 1), std::pair(-2, -1), std::pair(2, -1), std::pair(-2, 1),
-        std::pair(1, 2), std::pair(-1, -2), std::pair(1, -2), std::pair(-1, 2),
-    };
-    for (int i = 0; i < 8; i++) {
-        int target_x = x + knight_moves[i].first;
-        int target_y = y + knight_moves[i].second;
-        if (target_x < 0 || target_x >= 8 || target_y < 0 || target_y >= 8) {
-            continue;
+    Bitboard occ = occupied() ^ bitboard::square_bb(from) ^ bitboard::square_bb(to);
+    if (move.is_en_passant()) {
+        occ ^= bitboard::square_bb(is_white ? to - 8 : to + 8);
+    }
+    Bitboard attackers = attackers_to(to, occ) & occ;
+    int result = 1;
+    while (true) {
+        is_white = !is_white;
+        Bitboard own_attackers = attackers & by_color[color_of(is_white)];
+        if (!own_attackers) {
+            break;
         }
-
-        int target_square = target_y * 8 + target_x;
-        if (full_board[target_square] && full_board[target_square].is_white == piece.is_white) {
-            continue;
+        result ^= 1;
+        Piece::piece_type type = Piece::NONE;
+        Bitboard from_bb = least_valuable_attacker(*this, own_attackers, type);
+        // The king can only take last
+        if (type == Piece::King) {
+            return (attackers & by_color[color_of(!is_white)]) ? result ^ 1 : result;
         }
-
-        moves.push_back(Move(piece.indexed_position, target_square));
+        swap = see_values[type] - swap;
+        if (swap < result) {
+            break;
+        }
+        occ ^= from_bb;
+        attackers = (attackers | xray_attackers(to, occ)) & occ;
     }
+    return result;
 }
 
-bool is_inside_board(int square)
+// Looks outward from the square with each piece's attack pattern, cheapest patterns first
+bool Board::is_square_attacked(int square, bool by_white, Bitboard occ) const
 {
-    return square >= 0 && square <= 63;
+    Bitboard attackers = by_color[color_of(by_white)];
+
+    if (bitboard::pawn_attacks[color_of(!by_white)][square] & by_type[Piece::Pawn] & attackers) {
+        return true;
+    }
+    if (bitboard::knight_attacks[square] & by_type[Piece::Knight] & attackers) {
+        return true;
+    }
+    if (bitboard::king_attacks[square] & by_type[Piece::King] & attackers) {
+        return true;
+    }
+    Bitboard diagonals = (by_type[Piece::Bishop] | by_type[Piece::Queen]) & attackers;
+    if (bitboard::bishop_attacks(square, occ) & diagonals) {
+        return true;
+    }
+    Bitboard orthogonals = (by_type[Piece::Rook] | by_type[Piece::Queen]) & attackers;
+    return bitboard::rook_attacks(square, occ) & orthogonals;
 }
 
-void Board::add_pawn_moves(Piece &piece, std::vector<Move> &moves)
+template <Color Us> LegalityMasks Board::compute_legality_masks() const
 {
-    auto push_pawn_move = [&](Move move) {
-        if (move.end_pos / 8 == (is_white_turn ? 7 : 0)) {
-            move.promotion = Piece::piece_type::Queen;
-            moves.push_back(move);
-            move.promotion = Piece::piece_type::Rook;
-            moves.push_back(move);
-            move.promotion = Piece::piece_type::Bishop;
-            moves.push_back(move);
-            move.promotion = Piece::piece_type::Knight;
-            moves.push_back(move);
-        } else {
-            moves.push_back(move);
-        }
-    };
+    constexpr Color Them = Us == White ? Black : White;
+    LegalityMasks masks;
 
-    int y = piece.indexed_position / 8;
-    int x = piece.indexed_position % 8;
-    int forward = piece.is_white ? +8 : -8;
-    int start_rank = piece.is_white ? 1 : 6;
-    bool is_first_move = y == start_rank;
-
-    int target_square = piece.indexed_position + forward;
-    if (is_inside_board(target_square) && !full_board[target_square]) {
-        push_pawn_move(Move(piece.indexed_position, target_square));
-        target_square = piece.indexed_position + forward * 2;
-        if (is_first_move && is_inside_board(target_square) && !full_board[target_square]) {
-            moves.push_back(Move(piece.indexed_position, target_square));
-        }
+    masks.king_square = king_squares[Us];
+    if (masks.king_square == -1) {
+        return masks;
     }
 
-    auto is_square_capturable = [&](int square) {
-        if (is_inside_board(square)) {
-            return (full_board[square].type != Piece::NONE && piece.is_white != full_board[square].is_white) || square == en_passant_square;
+    Bitboard occ = occupied();
+    Bitboard enemies = by_color[Them];
+    masks.checkers = attackers_to(masks.king_square, occ) & enemies;
+
+    // Enemy sliders that would see the king on an empty board pin a lone friendly piece in between
+    Bitboard snipers = (bitboard::rook_attacks(masks.king_square, 0) & (by_type[Piece::Rook] | by_type[Piece::Queen]))
+        | (bitboard::bishop_attacks(masks.king_square, 0) & (by_type[Piece::Bishop] | by_type[Piece::Queen]));
+    snipers &= enemies;
+    while (snipers) {
+        Bitboard blockers = bitboard::between_bb[masks.king_square][bitboard::pop_lsb(snipers)] & occ;
+        if (bitboard::count(blockers) == 1 && (blockers & by_color[Us])) {
+            masks.pinned |= blockers;
         }
-        return false;
-    };
-
-    // Check for captures
-    target_square = piece.indexed_position + forward + 1;
-    if (x != 7 && (is_mini_board || is_square_capturable(target_square))) {
-        push_pawn_move(Move(piece.indexed_position, target_square));
     }
 
-    target_square = piece.indexed_position + forward - 1;
-    if (x != 0 && (is_mini_board || is_square_capturable(target_square))) {
-        push_pawn_move(Move(piece.indexed_position, target_square));
+    if (masks.checkers) {
+        int checker = bitboard::lsb(masks.checkers);
+        // With two checkers nothing but the king can move
+        masks.check_mask = bitboard::count(masks.checkers) > 1 ? 0 : masks.checkers | bitboard::between_bb[masks.king_square][checker];
     }
+    return masks;
 }
 
-void Chess::Board::add_king_moves(Piece &piece, std::vector<Move> &moves)
+LegalityMasks Board::compute_legality_masks(bool is_white) const
 {
-    int x = piece.indexed_position % 8;
-    int y = piece.indexed_position / 8;
-
-    const std::pair<int, int> knight_moves[8] = {
-        std::pair(0, 1), std::pair(1, 1), std::pair(1, 0), std::pair(1, -1), std::pair(0, -1), std::pair(-1, -1), std::pair(-1, 0), std::pair(-1, 1),
-    };
-    for (int i = 0; i < 8; i++) {
-        int target_x = x + knight_moves[i].first;
-        int target_y = y + knight_moves[i].second;
-        if (target_x < 0 || target_x >= 8 || target_y < 0 || target_y >= 8) {
-            continue;
-        }
+    return is_white ? compute_legality_masks<White>() : compute_legality_masks<Black>();
+}
 
-        int target_square = target_y * 8 + target_x;
-        if (full_board[target_square] && full_board[target_square].is_white == piece.is_white) {
-            continue;
-        }
+bool Chess::Board::is_square_safe(int square, bool cur_is_white)
+{
+    return !is_square_attacked(square, !cur_is_white, occupied());
+}
 
-        moves.push_back(Move(piece.indexed_position, target_square));
-    }
+bool Chess::Board::is_king_safe(bool cur_is_white)
+{
+    int king_square = king_squares[color_of(cur_is_white)];
 
-    if (is_mini_board) {
-        return;
+    if (king_square == -1) {
+        return true;
     }
+    return is_square_safe(king_square, cur_is_white);
+}
 
-    Board mini_board;
-    mini_board.log_FEN = false;
-    mini_board.is_mini_board = true;
-    mini_board.load_from_FEN(get_FEN());
+// Neither side can ever mate: bare kings, a single minor piece, or only bishops all on the same square color
+bool Board::is_insufficient_material() const
+{
+    const Bitboard dark_squares = 0xAA55AA55AA55AA55ULL;
 
-    if (!mini_board.is_king_safe(is_white_turn)) {
-        return;
+    if (by_type[Piece::Pawn] | by_type[Piece::Rook] | by_type[Piece::Queen]) {
+        return false;
     }
-
-    auto check_square = [&](int s) { return !full_board[s] && mini_board.is_square_safe(s, is_white_turn); };
-    // Castle
-    if (is_white_turn) {
-        if (king_white_castle && !full_board[6] && check_square(5)) {
-            moves.push_back(Move(piece.indexed_position, 6));
-        }
-        if (queen_white_castle && !full_board[1] && !full_board[2] && check_square(3)) {
-            moves.push_back(Move(piece.indexed_position, 2));
-        }
-    } else {
-        if (king_black_castle && !full_board[62] && check_square(61)) {
-            moves.push_back(Move(piece.indexed_position, 62));
-        }
-        if (queen_black_castle && !full_board[57] && check_square(59) && !full_board[58]) {
-            moves.push_back(Move(piece.indexed_position, 58));
-        }
+    Bitboard minors = by_type[Piece::Knight] | by_type[Piece::Bishop];
+    if (bitboard::count(minors) <= 1) {
+        return true;
     }
+    Bitboard bishops = by_type[Piece::Bishop];
+    return !by_type[Piece::Knight] && (!(bishops & dark_squares) || !(bishops & ~dark_squares));
 }
 
-std::vector<Move> Board::get_all_moves_for_square(int indexed_square)
+template <Color Us> MoveList Board::get_all_legal_moves()
 {
-    std::vector<Move> result;
+    MoveList result;
 
-    for (auto move : legal_moves) {
-        if (move.start_pos == indexed_square) {
-            result.push_back(move);
-        }
-    }
+    generate_moves<Us>(compute_legality_masks<Us>(), AllMoves, ~0ULL, result);
     return result;
 }
 
-void Board::display_square_moves(int index)
+MoveList Board::get_all_legal_moves(bool is_mover_white)
 {
-    moves_for_selected_piece.clear();
+    return is_mover_white ? get_all_legal_moves<White>() : get_all_legal_moves<Black>();
+}
 
-    for (auto move : get_all_moves_for_square(index)) {
-        moves_for_selected_piece.push_back(move.end_pos);
+// Appends the legal moves of the given kind made by the pieces standing on origins
+template <Color Us> void Board::generate_moves(const LegalityMasks &masks, gen_type type, Bitboard origins, MoveList &moves)
+{
+    if (bitboard::count(masks.checkers) < 2) {
+        add_pawn_moves<Us>(masks, type, origins, moves);
+        add_knight_moves<Us>(masks, type, origins, moves);
+        add_sliding_moves<Us>(masks, type, origins, moves);
+    }
+    if (masks.king_square != -1 && (origins & bitboard::square_bb(masks.king_square))) {
+        add_king_moves<Us>(masks, type, moves);
     }
-    if (moves_for_selected_piece.size() != 0) {
-        selected_piece = index;
+}
+
+void Board::generate_moves(bool is_white, const LegalityMasks &masks, gen_type type, Bitboard origins, MoveList &moves)
+{
+    if (is_white) {
+        generate_moves<White>(masks, type, origins, moves);
     } else {
-        selected_piece = -1;
+        generate_moves<Black>(masks, type, origins, moves);
     }
 }
 
-void Board::add_sliding_moves(Piece &piece, std::vector<Move> &moves)
+// Squares a piece move of the given kind may land on, before legality
+template <Color Us> Bitboard Board::stage_targets(gen_type type) const
 {
-    auto square = piece.indexed_position;
-    int start_dir = piece.type == Piece::Bishop ? 4 : 0;
-    int end_dir = piece.type == Piece::Rook ? 4 : 8;
+    constexpr Color Them = Us == White ? Black : White;
 
-    for (int direction_index = start_dir; direction_index < end_dir; direction_index++) {
-        for (int n = 0; n < distance_to_borders[square][direction_index]; n++) {
-            int target_square = square + direction_offsets[direction_index] * (n + 1);
-            Piece &piece_on_target_square = full_board[target_square];
-            if (piece_on_target_square.type == Piece::NONE) {
-                moves.push_back(Move(square, target_square));
-                continue;
-            }
+    switch (type) {
+    case Captures:
+        return by_color[Them];
+    case Quiets:
+        return ~occupied();
+    default:
+        return ~by_color[Us];
+    }
+}
 
-            if (piece_on_target_square.is_white != piece.is_white) {
-                moves.push_back(Move(square, target_square));
-            } else {
-            }
-            break;
-        }
+// A pinned piece may only move along the line joining it to its king
+static Bitboard pin_mask(const LegalityMasks &masks, int square)
+{
+    if (masks.pinned & bitboard::square_bb(square)) {
+        return bitboard::line_bb[masks.king_square][square];
     }
+    return ~0ULL;
 }
 
-void Board::update_sprite_position(sf::RectangleShape &shape, sf::Vector2f &board_origin, int index)
+static void add_moves_to_targets(int start_pos, Bitboard targets, MoveList &moves)
 {
-    int x = index % 8;
-    int y = index / 8;
+    while (targets) {
+        moves.push_back(Move(start_pos, bitboard::pop_lsb(targets)));
+    }
+}
 
-    float true_x = board_origin.x + square_size * x;
-    float true_y = board_origin.y - square_size * (1 + y);
+template <Color Us> void Board::add_knight_moves(const LegalityMasks &masks, gen_type type, Bitboard origins, MoveList &moves)
+{
+    // A pinned knight can never stay on the pin line
+    Bitboard knights = pieces(Us == White, Piece::Knight) & ~masks.pinned & origins;
+    Bitboard targets = stage_targets<Us>(type) & masks.check_mask;
 
-    shape.setSize({(float)square_size, (float)square_size});
-    shape.setPosition({true_x, true_y});
+    while (knights) {
+        int square = bitboard::pop_lsb(knights);
+        add_moves_to_targets(square, bitboard::knight_attacks[square] & targets, moves);
+    }
 }
 
-void Board::draw_board(sf::RenderWindow &window)
+// Promotions, even without a capture, belong to the captures stage
+template <Color Us> void Board::add_pawn_moves(const LegalityMasks &masks, gen_type type, Bitboard origins, MoveList &moves)
 {
-    window.draw(this->sprite);
-    auto origin = this->get_origin();
-
-    if (selected_piece != -1) {
-        update_sprite_position(main_highlighted_square_shape, origin, selected_piece);
-        window.draw(main_highlighted_square_shape);
-        std::set<int> tmp_set;
-        for (auto s : moves_for_selected_piece) {
-            tmp_set.insert(s);
-        }
-        for (auto square : tmp_set) {
-            update_sprite_position(highlighted_square_shape, origin, square);
-            window.draw(highlighted_square_shape);
+    constexpr Color Them = Us == White ? Black : White;
+    constexpr Bitboard promotion_rank = Us == White ? bitboard::rank_8 : bitboard::rank_1;
+    constexpr Bitboard double_push_rank = Us == White ? bitboard::rank_3 : bitboard::rank_6;
+    constexpr int en_passant_rank = Us == White ? 5 : 2;
+    constexpr int forward = Us == White ? 8 : -8;
+    Bitboard pawns = pieces(Us == White, Piece::Pawn) & origins;
+    Bitboard enemies = by_color[Them];
+    Bitboard push_targets = type == Captures ? promotion_rank : type == Quiets ? ~promotion_rank : ~0ULL;
+    Bitboard empty = ~occupied();
+
+    auto push_pawn_moves = [&](Bitboard targets, int offset) {
+        targets &= masks.check_mask;
+        while (targets) {
+            int target_square = bitboard::pop_lsb(targets);
+            int start_pos = target_square - offset;
+            if (!(pin_mask(masks, start_pos) & bitboard::square_bb(target_square))) {
+                continue;
+            }
+            if (promotion_rank & bitboard::square_bb(target_square)) {
+                moves.push_back(Move(start_pos, target_square, Piece::piece_type::Queen));
+                moves.push_back(Move(start_pos, target_square, Piece::piece_type::Rook));
+                moves.push_back(Move(start_pos, target_square, Piece::piece_type::Bishop));
+                moves.push_back(Move(start_pos, target_square, Piece::piece_type::Knight));
+            } else {
+                moves.push_back(Move(start_pos, target_square));
+            }
         }
+    };
+
+    Bitboard single_push = bitboard::pawn_push<Us>(pawns) & empty;
+    push_pawn_moves(single_push & push_targets, forward);
+    push_pawn_moves(bitboard::pawn_push<Us>(single_push & double_push_rank) & empty & push_targets, forward * 2);
+    if (type == Quiets) {
+        return;
     }
-    for (int i = 0; i < 64; i++) {
-        auto &piece = full_board[i];
-        if (piece.type == Piece::NONE) {
-            continue;
-        }
-        auto &sprite = manager->sprite_piece_array[piece.get_texture_index()];
-        int x = piece.indexed_position % 8;
-        int y = piece.indexed_position / 8;
-        float true_x = origin.x + square_size * x;
-        float true_y = origin.y - square_size * (1 + y);
-        sprite.setPosition(true_x, true_y);
-        if (piece.indexed_position == selected_piece && is_piece_picked_up) {
-            auto mouse_pos = sf::Mouse::getPosition(window);
-            auto sprite_size = sprite.getGlobalBounds();
-            sprite.setPosition(mouse_pos.x - sprite_size.width / 2, mouse_pos.y - sprite_size.height / 2);
+    push_pawn_moves(bitboard::pawn_east_attacks<Us>(pawns) & enemies, forward + 1);
+    push_pawn_moves(bitboard::pawn_west_attacks<Us>(pawns) & enemies, forward - 1);
+
+    // The en passant square is only a target for the side whose pawns can reach it
+    if (en_passant_square == -1 || en_passant_square / 8 != en_passant_rank || masks.king_square == -1) {
+        return;
+    }
+    int captured_square = en_passant_square - forward;
+    Bitboard capturers = bitboard::pawn_attacks[Them][en_passant_square] & pawns;
+    while (capturers) {
+        int start_pos = bitboard::pop_lsb(capturers);
+        // Two pawns leave the same rank at once, so pins and checks are verified on the resulting occupancy
+        Bitboard occ_after = (occupied() ^ bitboard::square_bb(start_pos) ^ bitboard::square_bb(captured_square))
+            | bitboard::square_bb(en_passant_square);
+        if (!(attackers_to(masks.king_square, occ_after) & enemies & ~bitboard::square_bb(captured_square))) {
+            moves.push_back(Move(start_pos, en_passant_square, Move::EnPassant));
         }
-        window.draw(sprite);
     }
-    promotion_popup->draw(window, *this);
 }
 
-void Board::precompute_distance_to_borders()
+template <Color Us> void Board::add_king_moves(const LegalityMasks &masks, gen_type type, MoveList &moves)
 {
-    for (int file = 0; file < 8; file++) {
-        for (int rank = 0; rank < 8; rank++) {
-            int numNorth = 7 - rank;
-            int numSouth = rank;
-            int numEast = 7 - file;
-            int numWest = file;
+    constexpr int king_start = Us == White ? 4 : 60;
+    if (masks.king_square == -1) {
+        return;
+    }
+    int square = masks.king_square;
+    Bitboard occ = occupied();
+    // The king is lifted off the board so it cannot hide behind itself along a checking ray
+    Bitboard occ_without_king = occ ^ bitboard::square_bb(square);
+    Bitboard targets = bitboard::king_attacks[square] & stage_targets<Us>(type);
+    while (targets) {
+        int target_square = bitboard::pop_lsb(targets);
+        if (!is_square_attacked(target_square, Us == Black, occ_without_king)) {
+            moves.push_back(Move(square, target_square));
+        }
+    }
 
-            int square_index = rank * 8 + file;
+    if (masks.checkers || type == Captures || square != king_start) {
+        return;
+    }
 
-            distance_to_borders[square_index][0] = numNorth;
-            distance_to_borders[square_index][1] = numSouth;
-            distance_to_borders[square_index][2] = numWest;
-            distance_to_borders[square_index][3] = numEast;
-            distance_to_borders[square_index][4] = std::min(numNorth, numWest);
-            distance_to_borders[square_index][5] = std::min(numSouth, numEast);
-            distance_to_borders[square_index][6] = std::min(numNorth, numEast);
-            distance_to_borders[square_index][7] = std::min(numSouth, numWest);
-        }
+    // Castle
+    if (is_legal_castle<Us>(king_start + 2)) {
+        moves.push_back(Move(square, king_start + 2, Move::Castle));
+    }
+    if (is_legal_castle<Us>(king_start - 2)) {
+        moves.push_back(Move(square, king_start - 2, Move::Castle));
     }
 }
 
-std::string Move::get_clean_coordinate(char pos)
+// Moves built by the GUI or read from UCI only know their squares and promotion, the castle and en passant flags
+// follow from the position
+Move Board::with_flags(Move move) const
 {
-    char x = pos % 8;
-    char y = pos / 8;
+    int start_pos = move.start_pos();
+    int end_pos = move.end_pos();
+    Piece::piece_type type = type_at(start_pos);
 
-    return std::string(1, 'a' + x) + std::string(1, '1' + y);
+    if (move.flags() != Move::Normal) {
+        return move;
+    }
+    if (type == Piece::King && std::abs(end_pos - start_pos) == 2) {
+        return Move(start_pos, end_pos, Move::Castle);
+    }
+    if (type == Piece::Pawn && end_pos == en_passant_square && (start_pos - end_pos) % 8 != 0) {
+        return Move(start_pos, end_pos, Move::EnPassant);
+    }
+    return move;
 }
 
-std::string Chess::Move::to_string(int pos)
+// Validates a single move against the position without generating the others: it is legal exactly when the
+// generators would emit it, flags included
+template <Color Us> bool Board::is_legal(Move move) const
 {
-    int rank = pos / 8;
-    int file = pos % 8;
+    constexpr Color Them = Us == White ? Black : White;
+    constexpr Bitboard promotion_rank = Us == White ? bitboard::rank_8 : bitboard::rank_1;
+    constexpr Bitboard double_push_rank = Us == White ? bitboard::rank_3 : bitboard::rank_6;
+    constexpr int en_passant_rank = Us == White ? 5 : 2;
+    constexpr int forward = Us == White ? 8 : -8;
+    int start_pos = move.start_pos();
+    int end_pos = move.end_pos();
+    Bitboard start_bb = bitboard::square_bb(start_pos);
+    Bitboard end_bb = bitboard::square_bb(end_pos);
+    Bitboard occ = occupied();
+    int king_square = king_squares[Us];
+
+    // Flags 3 and 8-15 are never produced by the encoding
+    if (!(by_color[Us] & start_bb) || (by_color[Us] & end_bb) || move.flags() == 3 || move.flags() > 7) {
+        return false;
+    }
+    Piece::piece_type type = type_at(start_pos);
+    if (type != Piece::Pawn && (move.flags() & Move::Promotion)) {
+        return false;
+    }
 
-    std::string res = "";
-    res += 'a' + file;
-    res += '1' + rank;
-    return res;
-}
+    if (type == Piece::King) {
+        if (move.is_castle()) {
+            return is_legal_castle<Us>(end_pos) && !is_square_attacked(start_pos, Them == White, occ);
+        }
+        // The king is lifted off the board so it cannot hide behind itself along a checking ray
+        return move.flags() == Move::Normal && (bitboard::king_attacks[start_pos] & end_bb)
+            && !is_square_attacked(end_pos, Them == White, occ ^ start_bb);
+    }
+    if (move.is_castle()) {
+        return false;
+    }
 
-bool Chess::Move::operator==(const Move &other) const
-{
-    return start_pos == other.start_pos && end_pos == other.end_pos;
-}
+    // Pseudo legal shape, the captured square only differs from the end square for en passant
+    int captured_square = end_pos;
+    switch (type) {
+    case Piece::Pawn:
+        if (move.is_en_passant()) {
+            if (end_pos != en_passant_square || end_pos / 8 != en_passant_rank || !(bitboard::pawn_attacks[Us][start_pos] & end_bb)
+                || !(pieces(Them == White, Piece::Pawn) & bitboard::square_bb(end_pos - forward)) || king_square == -1) {
+                return false;
+            }
+            captured_square = end_pos - forward;
+        } else if (end_bb & by_color[Them]) {
+            if (!(bitboard::pawn_attacks[Us][start_pos] & end_bb)) {
+                return false;
+            }
+        } else if (end_pos - start_pos == 2 * forward) {
+            if (!(bitboard::pawn_push<Us>(start_bb) & double_push_rank & ~occ) || (occ & end_bb)) {
+                return false;
+            }
+        } else if (end_pos - start_pos != forward || (occ & end_bb)) {
+            return false;
+        }
+        // Reaching the last rank requires a promotion piece, any other pawn move forbids one
+        if (((end_bb & promotion_rank) != 0) != ((move.flags() & Move::Promotion) != 0)) {
+            return false;
+        }
+        break;
+    case Piece::Knight:
+        if (move.flags() != Move::Normal || !(bitboard::knight_attacks[start_pos] & end_bb)) {
+            return false;
+        }
+        break;
+    case Piece::Bishop:
+    case Piece::Rook:
+    case Piece::Queen: {
+        Bitboard attacks = type == Piece::Bishop ? bitboard::bishop_attacks(start_pos, occ)
+            : type == Piece::Rook                ? bitboard::rook_attacks(start_pos, occ)
+                                                 : bitboard::queen_attacks(start_pos, occ);
+        if (move.flags() != Move::Normal || !(attacks & end_bb)) {
+            return false;
+        }
+        break;
+    }
+    default:
+        return false;
+    }
 
-Chess::PromotionPopup::PromotionPopup()
-{
-    this->square.setFillColor(sf::Color(127, 127, 127, 255));
+    if (king_square == -1) {
+        return true;
+    }
+    // Pins and check evasions at once: no enemy piece, bar the captured one, may attack the king once the move is made
+    Bitboard captured_bb = bitboard::square_bb(captured_square);
+    Bitboard occ_after = (occ ^ start_bb ^ (captured_bb & ~end_bb)) | end_bb;
+    return !(attackers_to(king_square, occ_after) & by_color[Them] & ~captured_bb);
 }
 
-void Chess::PromotionPopup::show(Move move)
+bool Board::is_legal(Move move) const
 {
-    visible = true;
-    this->move = move;
-    is_direction_up = this->move.end_pos / 8 == 0;
+    return is_white_turn ? is_legal<White>(move) : is_legal<Black>(move);
 }
 
-void Chess::PromotionPopup::draw(sf::RenderWindow &window, Board &board)
+// Rights, rook, empty squares and a safe king path for the castle whose king lands on end_pos, the king not being in
+// check is left to the caller
+template <Color Us> bool Board::is_legal_castle(int end_pos) const
 {
-    if (!visible) {
-        return;
+    constexpr Color Them = Us == White ? Black : White;
+    constexpr int king_start = Us == White ? 4 : 60;
+    bool king_side_right = Us == White ? king_white_castle : king_black_castle;
+    bool queen_side_right = Us == White ? queen_white_castle : queen_black_castle;
+    Bitboard occ = occupied();
+    int rook_square;
+
+    if (king_squares[Us] != king_start) {
+        return false;
     }
-
-    auto origin = board.get_origin();
-    for (int i = 0; i < 4; i++) {
-        int index = move.end_pos + 8 * i * (is_direction_up ? 1 : -1);
-        int x = index % 8;
-        int y = index / 8;
-
-        float true_x = origin.x + board.square_size * x;
-        float true_y = origin.y - board.square_size * (1 + y);
-
-        square.setRadius(board.square_size / 2);
-        square.setPosition({true_x, true_y});
-
-        window.draw(square);
-        int texture_index = Piece::get_texture_index(promotion_order[i], !is_direction_up);
-        auto &sprite = board.manager->sprite_piece_array[texture_index];
-        sprite.setPosition(square.getPosition());
-        window.draw(sprite);
+    if (end_pos == king_start + 2 && king_side_right) {
+        rook_square = king_start + 3;
+    } else if (end_pos == king_start - 2 && queen_side_right) {
+        rook_square = king_start - 4;
+    } else {
+        return false;
+    }
+    if (!(pieces(Us == White, Piece::Rook) & bitboard::square_bb(rook_square)) || (occ & bitboard::between_bb[king_start][rook_square])) {
+        return false;
+    }
+    Bitboard king_path = bitboard::between_bb[king_start][end_pos] | bitboard::square_bb(end_pos);
+    while (king_path) {
+        if (is_square_attacked(bitboard::pop_lsb(king_path), Them == White, occ)) {
+            return false;
+        }
     }
+    return true;
 }
 
-void Chess::PromotionPopup::scale(Board &board)
+MoveList Board::get_all_moves_for_square(int indexed_square)
 {
+    MoveList result;
+
+    if (indexed_square == -1) {
+        return result;
+    }
+    for (auto move : StagedMoves(*this, bitboard::square_bb(indexed_square))) {
+        result.push_back(move);
+    }
+    return result;
 }
 
-Piece::piece_type Chess::PromotionPopup::select(int square)
+template <Color Us> void Board::add_sliding_moves(const LegalityMasks &masks, gen_type type, Bitboard origins, MoveList &moves)
 {
-    visible = false;
-    for (int i = 0; i < 4; i++) {
-        int target_square = move.end_pos + 8 * i * (is_direction_up ? 1 : -1);
-        if (square == target_square) {
-            return promotion_order[i];
-        }
+    Bitboard occ = occupied();
+    Bitboard targets = stage_targets<Us>(type) & masks.check_mask;
+
+    Bitboard diagonals = (pieces(Us == White, Piece::Bishop) | pieces(Us == White, Piece::Queen)) & origins;
+    while (diagonals) {
+        int square = bitboard::pop_lsb(diagonals);
+        add_moves_to_targets(square, bitboard::bishop_attacks(square, occ) & targets & pin_mask(masks, square), moves);
+    }
+    Bitboard orthogonals = (pieces(Us == White, Piece::Rook) | pieces(Us == White, Piece::Queen)) & origins;
+    while (orthogonals) {
+        int square = bitboard::pop_lsb(orthogonals);
+        add_moves_to_targets(square, bitboard::rook_attacks(square, occ) & targets & pin_mask(masks, square), moves);
     }
-    return Piece::piece_type::NONE;
 }
+
+// Used outside this file by perft
+template UndoInfo Board::make_move<White>(Move move);
+template UndoInfo Board::make_move<Black>(Move move);
+template void Board::unmake_move<White>(const UndoInfo &undo);
+template void Board::unmake_move<Black>(const UndoInfo &undo);
+template LegalityMasks Board::compute_legality_masks<White>() const;
+template LegalityMasks Board::compute_legality_masks<Black>() const;
+template MoveList Board::get_all_legal_moves<White>();
+template MoveList Board::get_all_legal_moves<Black>();
+template void Board::generate_moves<White>(const LegalityMasks &masks, gen_type type, Bitboard origins, MoveList &moves);
+template void Board::generate_moves<Black>(const LegalityMasks &masks, gen_type type, Bitboard origins, MoveList &moves);
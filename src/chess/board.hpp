@@ -1,10 +1,13 @@
 #pragma once
 
-#include <SFML/Graphics/Sprite.hpp>
-#include <SFML/Graphics/Texture.hpp>
+#include <chess/attack_maps.hpp>
+#include <chess/bitboard.hpp>
+#include <chess/fen.hpp>
+#include <chess/nnue.hpp>
 #include <chess/piece.hpp>
-#include <filesystem>
+#include <chess/position.hpp>
 #include <iostream>
+#include <string_view>
 #include <vector>
 
 #include "MoveLog.hpp"
@@ -12,109 +15,103 @@
 namespace Chess
 {
 
-class PromotionPopup;
+// Computed once per position so that every generator only emits legal moves
+struct LegalityMasks {
+    int king_square = -1;
+    Bitboard checkers = 0;
+    Bitboard pinned = 0;
+    Bitboard check_mask = ~0ULL; // Squares a non-king move has to land on to answer a check
+};
+
+// Moves a generator call emits: captures and promotions, the other moves, or both
+enum gen_type { Captures, Quiets, AllMoves };
+
+// Piece values of the static exchange evaluation, the king's only has to outweigh every other piece
+constexpr int see_values[6] = {100, 300, 300, 500, 900, 10000};
 
-class Board
+// The rules code around a Position, plus the game history. Nothing graphical, so it can be built into libchesscore.
+// Copy-make code and workers clone the Position alone: Position copy = board; ... board.restore(copy);
+class Board : public Position
 {
 public:
-    int square_size = 64;
-
-    sf::Sprite sprite;
-    sf::Texture texture;
-    RessourceManager *manager = nullptr;
     MoveLog move_history;
-    std::vector<Move> legal_moves;
-
-    Board();
-    ~Board();
 
-    void move_piece(Move move);
+    // When set, add_piece and remove_piece keep the accumulator up to date and evaluate() uses the network
+    const nnue::Network *network = nullptr;
+    nnue::Accumulator accumulator;
+
+    inline const Position &position() const { return *this; }
+    inline void restore(const Position &position)
+    {
+        static_cast<Position &>(*this) = position;
+        if (network) {
+            nnue::refresh(*network, *this, accumulator);
+        }
+    }
+    void set_network(const nnue::Network *network);
+    // Centipawns from the side to move, from the network when one is set, the piece-square tables otherwise
+    int evaluate() const;
+
+    template <Color Us> UndoInfo make_move(Move move);
+    template <Color Us> void unmake_move(const UndoInfo &undo);
+    UndoInfo make_move(Move move);
+    void unmake_move(const UndoInfo &undo);
     void play_move(Move move);
-    void check_if_move_voids_castle(Move move, Piece &moving_piece);
-
-    void setup_textures(std::filesystem::path path, RessourceManager *manager);
-    void setup_board_textures(std::filesystem::path path);
-    void setup_pieces_textures();
-
-    void update_sprite_position(sf::RectangleShape &shape, sf::Vector2f &board_origin, int index);
-
-    bool load_from_FEN_board(std::string fen_board);
-    bool load_from_FEN_color(std::string fen_color);
-    bool load_from_FEN_castle(std::string fen_castle);
-    bool load_from_FEN_en_passant(std::string fen_en_passant);
-    bool load_from_FEN_half_move(std::string fen_half_move);
-    bool load_from_FEN_full_move(std::string fen_full_move);
-    bool load_from_FEN(std::string FEN);
-
-    std::string get_FEN();
+    void describe_move(Move move, LogInstance &entry);
+    void describe_result(LogInstance &entry, int repetitions);
+    Move with_flags(Move move) const;
+    template <Color Us> bool is_legal(Move move) const;
+    bool is_legal(Move move) const;
+    bool undo_move();
+    bool redo_move();
+    void check_if_move_voids_castle(Move move);
+
+    bool load_from_FEN(std::string_view FEN);
+    void set_position(const FenPosition &position);
+
+    size_t write_FEN(char *buffer) const;
+    std::string get_FEN() const;
     void print_all_legal_moves();
-    int get_square_from_mouse(sf::Vector2i local_position);
-
-    void resize_board(unsigned width, unsigned height);
-    void scale_board();
 
     void add_piece(bool is_white, Piece::piece_type type, int indexed_pos);
-
+    void remove_piece(int indexed_pos);
+    void remove_piece(bool is_white, Piece::piece_type type, int indexed_pos);
+    Piece piece_at(int indexed_pos) const;
+    Piece::piece_type type_at(int indexed_pos) const;
+
+    Bitboard attacked_squares(bool by_white, Bitboard occ) const;
+    bitboard::SliderSet sliders(bool is_white, Bitboard occ) const;
+    Bitboard attackers_to(int square, Bitboard occ) const;
+    Bitboard xray_attackers(int square, Bitboard occ) const;
+    bool is_square_attacked(int square, bool by_white, Bitboard occ) const;
+    // Material won by the side moving once the captures on the target square are resolved, each side taking back with
+    // its least valuable attacker or stopping when that loses. Sliders behind the capturers join in, pins are ignored.
+    int see(Move move) const;
+    // Same as see(move) >= threshold, but stops as soon as the outcome is known
+    bool see_ge(Move move, int threshold) const;
+    template <Color Us> LegalityMasks compute_legality_masks() const;
+    LegalityMasks compute_legality_masks(bool is_white) const;
     bool is_square_safe(int square, bool cur_is_white);
     bool is_king_safe(bool is_white);
-    void show_last_move();
-
-    std::vector<Move> get_all_legal_moves(bool is_mover_white);
-    void add_sliding_moves(Piece &piece, std::vector<Move> &moves);
-    void add_knight_moves(Piece &piece, std::vector<Move> &moves);
-    void add_pawn_moves(Piece &piece, std::vector<Move> &moves);
-    void add_king_moves(Piece &piece, std::vector<Move> &moves);
-    std::vector<Move> get_all_moves_for_square(int indexed_square);
-    void display_square_moves(int index);
-
-    void scale_pieces();
-
-    sf::Vector2f get_origin();
-    void draw_board(sf::RenderWindow &window);
-    bool is_piece_picked_up = false;
-
-    Piece full_board[64];
-    std::vector<int> moves_for_selected_piece;
-    int selected_piece = -1;
-    sf::RectangleShape highlighted_square_shape;
-    sf::RectangleShape main_highlighted_square_shape;
-
-    int direction_offsets[8] = {8, -8, -1, 1, 7, -7, 9, -9}; // Goes up down left right up-left down-left up-right down-right
-    int distance_to_borders[64][8];
-    void precompute_distance_to_borders();
-
-    bool is_white_turn = true;
-
-    bool king_white_castle = true;
-    bool queen_white_castle = true;
-    bool king_black_castle = true;
-    bool queen_black_castle = true;
-
-    int en_passant_square = -1; // -1 means no en passant
-    int halfmove_clock = 0;
-    int fullmove_number = 1;
+    bool is_insufficient_material() const;
+
+    template <Color Us> MoveList get_all_legal_moves();
+    MoveList get_all_legal_moves(bool is_mover_white);
+    template <Color Us> void generate_moves(const LegalityMasks &masks, gen_type type, Bitboard origins, MoveList &moves);
+    void generate_moves(bool is_white, const LegalityMasks &masks, gen_type type, Bitboard origins, MoveList &moves);
+    template <Color Us> Bitboard stage_targets(gen_type type) const;
+    template <Color Us> void add_sliding_moves(const LegalityMasks &masks, gen_type type, Bitboard origins, MoveList &moves);
+    template <Color Us> void add_knight_moves(const LegalityMasks &masks, gen_type type, Bitboard origins, MoveList &moves);
+    template <Color Us> void add_pawn_moves(const LegalityMasks &masks, gen_type type, Bitboard origins, MoveList &moves);
+    template <Color Us> void add_king_moves(const LegalityMasks &masks, gen_type type, MoveList &moves);
+    template <Color Us> bool is_legal_castle(int end_pos) const;
+    MoveList get_all_moves_for_square(int indexed_square);
+
+    uint64_t castling_hash() const;
+    uint64_t en_passant_hash() const;
+    uint64_t compute_hash() const;
 
     bool log_FEN = false;
-    bool is_mini_board = false;
-    PromotionPopup *promotion_popup = nullptr;
-};
-
-class PromotionPopup
-{
-public:
-    PromotionPopup();
-    void show(Move move);
-    void draw(sf::RenderWindow &window, Board &board);
-    void scale(Board &board);
-    Piece::piece_type select(int square);
-
-    bool visible = false;
-    Move move;
-
-private:
-    bool is_direction_up;
-    sf::CircleShape square;
-    const Chess::Piece::piece_type promotion_order[4] = {Piece::Queen, Piece::Knight, Piece::Rook, Piece::Bishop};
 };
 
 } // namespace Chess
\ No newline at end of file
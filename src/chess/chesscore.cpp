@@ -0,0 +1,125 @@
+#include "chesscore.h"
+
+#include <new>
+#include <vector>
+
+#include "board.hpp"
+#include "perft.hpp"
+
+// The position owns the undo information of the moves played through the C interface
+struct chess_position {
+    Chess::Board board;
+    std::vector<Chess::UndoInfo> undo_stack;
+};
+
+static_assert(Chess::max_FEN_length <= CHESS_MAX_FEN_LENGTH);
+
+int chesscore_api_version(void)
+{
+    return CHESSCORE_API_VERSION;
+}
+
+chess_position *chess_position_new(void)
+{
+    chess_position *position = new (std::nothrow) chess_position;
+
+    if (position) {
+        Chess::FenPosition start;
+        Chess::parse_FEN(Chess::default_FEN, start);
+        position->board.set_position(start);
+    }
+    return position;
+}
+
+void chess_position_free(chess_position *position)
+{
+    delete position;
+}
+
+int chess_position_load_fen(chess_position *position, const char *fen)
+{
+    Chess::FenPosition parsed;
+
+    if (Chess::FenError error = Chess::parse_FEN(fen, parsed)) {
+        return error.offset + 1;
+    }
+    position->board.set_position(parsed);
+    position->undo_stack.clear();
+    return 0;
+}
+
+size_t chess_position_get_fen(const chess_position *position, char *buffer)
+{
+    return position->board.write_FEN(buffer);
+}
+
+int chess_position_side_to_move(const chess_position *position)
+{
+    return position->board.is_white_turn ? 0 : 1;
+}
+
+uint64_t chess_position_hash(const chess_position *position)
+{
+    return position->board.zobrist_hash;
+}
+
+size_t chess_position_legal_moves(chess_position *position, uint16_t *moves)
+{
+    Chess::MoveList legal_moves = position->board.get_all_legal_moves(position->board.is_white_turn);
+
+    for (size_t i = 0; i < legal_moves.size(); i++) {
+        moves[i] = legal_moves[i].data;
+    }
+    return legal_moves.size();
+}
+
+int chess_position_make_move(chess_position *position, uint16_t move)
+{
+    Chess::Move candidate;
+
+    candidate.data = move;
+    if (!position->board.is_legal(candidate)) {
+        return -1;
+    }
+    position->undo_stack.push_back(position->board.make_move(candidate));
+    return 0;
+}
+
+int chess_position_unmake_move(chess_position *position)
+{
+    if (position->undo_stack.empty()) {
+        return -1;
+    }
+    position->board.unmake_move(position->undo_stack.back());
+    position->undo_stack.pop_back();
+    return 0;
+}
+
+uint64_t chess_position_perft(chess_position *position, int depth)
+{
+    if (depth < 0) {
+        return 0;
+    }
+    return Chess::perft(position->board, depth);
+}
+
+int chess_move_from_uci(const chess_position *position, const char *uci, uint16_t *move)
+{
+    Chess::Move parsed;
+
+    if (!Chess::Move::parse_UCI(uci, parsed)) {
+        return -1;
+    }
+    *move = position->board.with_flags(parsed).data;
+    return 0;
+}
+
+size_t chess_move_to_uci(uint16_t move, char *buffer)
+{
+    Chess::Move parsed;
+
+    parsed.data = move;
+    size_t length = parsed.write_UCI(buffer);
+    buffer[length] = '\0';
+    return length;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+// C interface of libchesscore, usable from C, ctypes or any FFI without linking the GUI.
+// Moves use the engine's 16 bit encoding: start square in bits 0-5, end square in bits 6-11 and flags in bits 12-15,
+// squares being numbered from a1 = 0 to h8 = 63. chess_move_from_uci and chess_move_to_uci convert them from and to text.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CHESSCORE_API_VERSION 1
+#define CHESS_MAX_FEN_LENGTH 100
+#define CHESS_MAX_MOVES 256
+
+typedef struct chess_position chess_position;
+
+int chesscore_api_version(void);
+
+// A new position starts from the initial position, NULL if it couldn't be allocated
+chess_position *chess_position_new(void);
+void chess_position_free(chess_position *position);
+
+// 0 on success, otherwise the 1 based column of the offending character; the position is unchanged on failure
+int chess_position_load_fen(chess_position *position, const char *fen);
+// buffer must hold CHESS_MAX_FEN_LENGTH characters, the FEN is null terminated and its length returned
+size_t chess_position_get_fen(const chess_position *position, char *buffer);
+// 0 when white is to move, 1 for black
+int chess_position_side_to_move(const chess_position *position);
+uint64_t chess_position_hash(const chess_position *position);
+
+// moves must hold CHESS_MAX_MOVES moves, the number of legal moves is returned
+size_t chess_position_legal_moves(chess_position *position, uint16_t *moves);
+// 0 when the move was legal and played, -1 otherwise
+int chess_position_make_move(chess_position *position, uint16_t move);
+// Takes back the last move played with chess_position_make_move, -1 when there is none
+int chess_position_unmake_move(chess_position *position);
+uint64_t chess_position_perft(chess_position *position, int depth);
+
+// Reads "e2e4" or "e7e8q" and completes the castle and en passant flags from the position, 0 on success
+int chess_move_from_uci(const chess_position *position, const char *uci, uint16_t *move);
+// buffer must hold 6 characters, the move is null terminated and its length returned
+size_t chess_move_to_uci(uint16_t move, char *buffer);
+
+#ifdef __cplusplus
+}
+#endif
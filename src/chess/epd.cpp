@@ -0,0 +1,76 @@
+#include "epd.hpp"
+
+#include <cctype>
+#include <charconv>
+#include <sstream>
+
+namespace Chess
+{
+
+static bool is_number(const std::string &token)
+{
+    if (token.empty()) {
+        return false;
+    }
+    for (char c : token) {
+        if (!isdigit(c)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The whole token as a number, false when it has other characters or overflows T
+template <typename T> static bool parse_number(const std::string &token, T &value)
+{
+    auto [end, error] = std::from_chars(token.data(), token.data() + token.size(), value);
+    return error == std::errc() && end == token.data() + token.size();
+}
+
+// Accepts the four EPD position fields, optionally followed by the two FEN clocks, then ';' separated operations.
+// Both "fen D1 20; D2 400;" and "fen ;D1 20 ;D2 400" are understood; operations other than D<depth> are ignored.
+bool parse_epd_line(const std::string &line, EpdEntry &entry)
+{
+    std::string spaced;
+    for (char c : line) {
+        if (c == ';') {
+            spaced += " ; ";
+        } else {
+            spaced += c;
+        }
+    }
+
+    std::stringstream ss(spaced);
+    std::vector<std::string> tokens;
+    std::string token;
+    while (ss >> token) {
+        tokens.push_back(token);
+    }
+    if (tokens.size() < 4) {
+        return false;
+    }
+
+    entry.fen = tokens[0] + " " + tokens[1] + " " + tokens[2] + " " + tokens[3];
+    entry.expected_perft.clear();
+    size_t i = 4;
+    for (int clock = 0; clock < 2 && i < tokens.size() && is_number(tokens[i]); clock++, i++) {
+        entry.fen += " " + tokens[i];
+    }
+
+    while (i < tokens.size()) {
+        std::vector<std::string> operation;
+        for (; i < tokens.size() && tokens[i] != ";"; i++) {
+            operation.push_back(tokens[i]);
+        }
+        i++;
+        int depth;
+        uint64_t nodes;
+        if (operation.size() == 2 && operation[0].size() > 1 && operation[0][0] == 'D' && parse_number(operation[0].substr(1), depth)
+            && parse_number(operation[1], nodes) && depth >= 1 && depth <= max_epd_depth) {
+            entry.expected_perft.push_back({depth, nodes});
+        }
+    }
+    return true;
+}
+
+} // namespace Chess
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Chess
+{
+
+struct EpdEntry {
+    std::string fen;
+    std::vector<std::pair<int, uint64_t>> expected_perft; // (depth, nodes) from "D<depth> <nodes>" operations
+};
+
+// D<depth> operations deeper than this, or whose numbers don't fit, are ignored
+constexpr int max_epd_depth = 20;
+
+bool parse_epd_line(const std::string &line, EpdEntry &entry);
+
+} // namespace Chess
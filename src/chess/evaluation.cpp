@@ -0,0 +1,191 @@
+#include "evaluation.hpp"
+
+#include "bitboard.hpp"
+
+namespace Chess
+{
+namespace evaluation
+{
+
+static constexpr int mg_values[6] = {82, 337, 365, 477, 1025, 0};
+static constexpr int eg_values[6] = {94, 281, 297, 512, 936, 0};
+
+// Seen from white with a8 first, the way the board is printed
+// clang-format off
+static constexpr int8_t mg_tables[6][64] = {
+    { // Pawn
+         0,   0,   0,   0,   0,   0,   0,   0,
+        50,  50,  50,  50,  50,  50,  50,  50,
+        10,  10,  20,  30,  30,  20,  10,  10,
+         5,   5,  10,  25,  25,  10,   5,   5,
+         0,   0,   0,  20,  20,   0,   0,   0,
+         5,  -5, -10,   0,   0, -10,  -5,   5,
+         5,  10,  10, -20, -20,  10,  10,   5,
+         0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    { // Knight
+       -50, -40, -30, -30, -30, -30, -40, -50,
+       -40, -20,   0,   0,   0,   0, -20, -40,
+       -30,   0,  10,  15,  15,  10,   0, -30,
+       -30,   5,  15,  20,  20,  15,   5, -30,
+       -30,   0,  15,  20,  20,  15,   0, -30,
+       -30,   5,  10,  15,  15,  10,   5, -30,
+       -40, -20,   0,   5,   5,   0, -20, -40,
+       -50, -40, -30, -30, -30, -30, -40, -50,
+    },
+    { // Bishop
+       -20, -10, -10, -10, -10, -10, -10, -20,
+       -10,   0,   0,   0,   0,   0,   0, -10,
+       -10,   0,   5,  10,  10,   5,   0, -10,
+       -10,   5,   5,  10,  10,   5,   5, -10,
+       -10,   0,  10,  10,  10,  10,   0, -10,
+       -10,  10,  10,  10,  10,  10,  10, -10,
+       -10,   5,   0,   0,   0,   0,   5, -10,
+       -20, -10, -10, -10, -10, -10, -10, -20,
+    },
+    { // Rook
+         0,   0,   0,   0,   0,   0,   0,   0,
+         5,  10,  10,  10,  10,  10,  10,   5,
+        -5,   0,   0,   0,   0,   0,   0,  -5,
+        -5,   0,   0,   0,   0,   0,   0,  -5,
+        -5,   0,   0,   0,   0,   0,   0,  -5,
+        -5,   0,   0,   0,   0,   0,   0,  -5,
+        -5,   0,   0,   0,   0,   0,   0,  -5,
+         0,   0,   0,   5,   5,   0,   0,   0,
+    },
+    { // Queen
+       -20, -10, -10,  -5,  -5, -10, -10, -20,
+       -10,   0,   0,   0,   0,   0,   0, -10,
+       -10,   0,   5,   5,   5,   5,   0, -10,
+        -5,   0,   5,   5,   5,   5,   0,  -5,
+         0,   0,   5,   5,   5,   5,   0,  -5,
+       -10,   5,   5,   5,   5,   5,   0, -10,
+       -10,   0,   5,   0,   0,   0,   0, -10,
+       -20, -10, -10,  -5,  -5, -10, -10, -20,
+    },
+    { // King, sheltered behind its pawns
+       -30, -40, -40, -50, -50, -40, -40, -30,
+       -30, -40, -40, -50, -50, -40, -40, -30,
+       -30, -40, -40, -50, -50, -40, -40, -30,
+       -30, -40, -40, -50, -50, -40, -40, -30,
+       -20, -30, -30, -40, -40, -30, -30, -20,
+       -10, -20, -20, -20, -20, -20, -20, -10,
+        20,  20,   0,   0,   0,   0,  20,  20,
+        20,  30,  10,   0,   0,  10,  30,  20,
+    },
+};
+
+static constexpr int8_t eg_tables[6][64] = {
+    { // Pawn, worth more the closer it gets to promoting
+         0,   0,   0,   0,   0,   0,   0,   0,
+        80,  80,  80,  80,  80,  80,  80,  80,
+        50,  50,  50,  50,  50,  50,  50,  50,
+        30,  30,  30,  30,  30,  30,  30,  30,
+        20,  20,  20,  20,  20,  20,  20,  20,
+        10,  10,  10,  10,  10,  10,  10,  10,
+         0,   0,   0,   0,   0,   0,   0,   0,
+         0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    { // Knight
+       -50, -40, -30, -30, -30, -30, -40, -50,
+       -40, -20,   0,   0,   0,   0, -20, -40,
+       -30,   0,  10,  15,  15,  10,   0, -30,
+       -30,   5,  15,  20,  20,  15,   5, -30,
+       -30,   0,  15,  20,  20,  15,   0, -30,
+       -30,   5,  10,  15,  15,  10,   5, -30,
+       -40, -20,   0,   5,   5,   0, -20, -40,
+       -50, -40, -30, -30, -30, -30, -40, -50,
+    },
+    { // Bishop
+       -20, -10, -10, -10, -10, -10, -10, -20,
+       -10,   0,   0,   0,   0,   0,   0, -10,
+       -10,   0,   5,  10,  10,   5,   0, -10,
+       -10,   5,   5,  10,  10,   5,   5, -10,
+       -10,   0,  10,  10,  10,  10,   0, -10,
+       -10,  10,  10,  10,  10,  10,  10, -10,
+       -10,   5,   0,   0,   0,   0,   5, -10,
+       -20, -10, -10, -10, -10, -10, -10, -20,
+    },
+    { // Rook
+         0,   0,   0,   0,   0,   0,   0,   0,
+        10,  10,  10,  10,  10,  10,  10,  10,
+         0,   0,   0,   0,   0,   0,   0,   0,
+         0,   0,   0,   0,   0,   0,   0,   0,
+         0,   0,   0,   0,   0,   0,   0,   0,
+         0,   0,   0,   0,   0,   0,   0,   0,
+         0,   0,   0,   0,   0,   0,   0,   0,
+         0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    { // Queen
+       -20, -10, -10,  -5,  -5, -10, -10, -20,
+       -10,   0,   0,   0,   0,   0,   0, -10,
+       -10,   0,   5,   5,   5,   5,   0, -10,
+        -5,   0,   5,   5,   5,   5,   0,  -5,
+        -5,   0,   5,   5,   5,   5,   0,  -5,
+       -10,   0,   5,   5,   5,   5,   0, -10,
+       -10,   0,   0,   0,   0,   0,   0, -10,
+       -20, -10, -10,  -5,  -5, -10, -10, -20,
+    },
+    { // King, heading for the center once the queens are gone
+       -50, -40, -30, -20, -20, -30, -40, -50,
+       -30, -20, -10,   0,   0, -10, -20, -30,
+       -30, -10,  20,  30,  30,  20, -10, -30,
+       -30, -10,  30,  40,  40,  30, -10, -30,
+       -30, -10,  30,  40,  40,  30, -10, -30,
+       -30, -10,  20,  30,  30,  20, -10, -30,
+       -30, -30,   0,   0,   0,   0, -30, -30,
+       -50, -30, -30, -30, -30, -30, -30, -50,
+    },
+};
+// clang-format on
+
+// Built at compile time, so boards set up during static initialization already see it
+static constexpr PsqTable build_psq()
+{
+    PsqTable table = {};
+
+    for (int type = 0; type < 6; type++) {
+        for (int square = 0; square < 64; square++) {
+            // The tables start at a8 while square 0 is a1, so white reads them mirrored and black as they are
+            int white_index = square ^ 56;
+            table.scores[White][type][square] = {(int16_t)(mg_values[type] + mg_tables[type][white_index]),
+                                                 (int16_t)(eg_values[type] + eg_tables[type][white_index])};
+            table.scores[Black][type][square] = {(int16_t)-(mg_values[type] + mg_tables[type][square]),
+                                                 (int16_t)-(eg_values[type] + eg_tables[type][square])};
+        }
+    }
+    return table;
+}
+
+constexpr PsqTable psq = build_psq();
+
+Score recompute(const Position &position, int &phase)
+{
+    int mg = 0;
+    int eg = 0;
+
+    phase = 0;
+    for (int color = White; color <= Black; color++) {
+        for (int type = Piece::Pawn; type <= Piece::King; type++) {
+            Bitboard bb = position.by_type[type] & position.by_color[color];
+            phase += phase_weights[type] * bitboard::count(bb);
+            while (bb) {
+                const Score &score = psq.scores[color][type][bitboard::pop_lsb(bb)];
+                mg += score.mg;
+                eg += score.eg;
+            }
+        }
+    }
+    return {(int16_t)mg, (int16_t)eg};
+}
+
+bool is_consistent(const Position &position)
+{
+    int phase;
+    Score score = recompute(position, phase);
+
+    return score.mg == position.psq_mg && score.eg == position.psq_eg && phase == position.phase;
+}
+
+} // namespace evaluation
+} // namespace Chess
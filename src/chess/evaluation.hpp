@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+#include "position.hpp"
+
+namespace Chess
+{
+namespace evaluation
+{
+
+struct Score {
+    int16_t mg;
+    int16_t eg;
+};
+
+// Material plus square bonus of a piece, positive for white and negative for black
+struct PsqTable {
+    Score scores[2][6][64]; // [color][piece type][square]
+};
+extern const PsqTable psq;
+
+constexpr int phase_weights[6] = {0, 1, 1, 2, 4, 0};
+constexpr int max_phase = 24; // Every knight, bishop, rook and queen still on the board
+
+// Centipawns from the side to move, the middlegame and endgame sums weighted by the phase
+inline int evaluate(const Position &position)
+{
+    int phase = position.phase < max_phase ? position.phase : max_phase;
+    int score = (position.psq_mg * phase + position.psq_eg * (max_phase - phase)) / max_phase;
+    return position.is_white_turn ? score : -score;
+}
+
+// Recomputes the sums from the bitboards, only meant to check the ones add_piece and remove_piece keep up to date
+Score recompute(const Position &position, int &phase);
+bool is_consistent(const Position &position);
+
+} // namespace evaluation
+} // namespace Chess
@@ -0,0 +1,188 @@
+#include "fen.hpp"
+
+#include "piece.hpp"
+
+namespace Chess
+{
+
+const char *FenError::message() const
+{
+    switch (code) {
+    case None:
+        return "no error";
+    case FieldCount:
+        return "expected 4 to 6 fields separated by single spaces";
+    case Placement:
+        return "invalid piece placement";
+    case SideToMove:
+        return "side to move must be 'w' or 'b'";
+    case Castling:
+        return "castling rights must be '-' or distinct letters among KQkq";
+    case EnPassant:
+        return "invalid en passant square";
+    case HalfMove:
+        return "invalid halfmove clock";
+    case FullMove:
+        return "invalid fullmove number";
+    }
+    return "unknown error";
+}
+
+// Piece type + 1 for every FEN piece letter, 0 for any other character
+static const struct PieceLetters {
+    uint8_t types[256] = {};
+
+    PieceLetters()
+    {
+        const char letters[] = "pnbrqk";
+        for (int type = Piece::Pawn; type <= Piece::King; type++) {
+            types[(uint8_t)letters[type]] = type + 1;
+            types[(uint8_t)(letters[type] - 'a' + 'A')] = type + 1;
+        }
+    }
+} piece_letters;
+
+static FenError parse_board(std::string_view field, size_t start, FenPosition &position)
+{
+    int rank = 7;
+    int file = 0;
+    bool previous_was_digit = false;
+
+    for (size_t i = 0; i < field.size(); i++) {
+        char c = field[i];
+        int type = piece_letters.types[(uint8_t)c] - 1;
+
+        if (type >= 0 && file < 8) {
+            Bitboard square = bitboard::square_bb(rank * 8 + file);
+            position.by_type[type] |= square;
+            position.by_color[c >= 'a' ? Black : White] |= square;
+            file += 1;
+            previous_was_digit = false;
+        } else if (c >= '1' && c <= '8' && !previous_was_digit && file + (c - '0') <= 8) {
+            file += c - '0';
+            previous_was_digit = true;
+        } else if (c == '/' && file == 8 && rank > 0) {
+            rank -= 1;
+            file = 0;
+            previous_was_digit = false;
+        } else {
+            return {FenError::Placement, start + i};
+        }
+    }
+    if (rank != 0 || file != 8) {
+        return {FenError::Placement, start + field.size()};
+    }
+
+    // Checked once the whole placement is read, so the error points at the start of the field
+    Bitboard kings = position.by_type[Piece::King];
+    if (bitboard::count(kings & position.by_color[White]) > 1 || bitboard::count(kings & position.by_color[Black]) > 1
+        || (position.by_type[Piece::Pawn] & (bitboard::rank_1 | bitboard::rank_8))) {
+        return {FenError::Placement, start};
+    }
+    return {};
+}
+
+static FenError parse_castling(std::string_view field, size_t start, FenPosition &position)
+{
+    if (field == "-") {
+        return {};
+    }
+    for (size_t i = 0; i < field.size(); i++) {
+        bool *right = nullptr;
+        switch (field[i]) {
+        case 'K':
+            right = &position.king_white_castle;
+            break;
+        case 'Q':
+            right = &position.queen_white_castle;
+            break;
+        case 'k':
+            right = &position.king_black_castle;
+            break;
+        case 'q':
+            right = &position.queen_black_castle;
+            break;
+        }
+        if (right == nullptr || *right) {
+            return {FenError::Castling, start + i};
+        }
+        *right = true;
+    }
+    return {};
+}
+
+// Clocks are limited to 6 digits so that they always fit max_FEN_length once written back
+static bool parse_clock(std::string_view field, int &value)
+{
+    if (field.empty() || field.size() > 6) {
+        return false;
+    }
+    value = 0;
+    for (char c : field) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        value = value * 10 + (c - '0');
+    }
+    return true;
+}
+
+FenError parse_FEN(std::string_view fen, FenPosition &position)
+{
+    std::string_view fields[6];
+    size_t starts[6] = {};
+    size_t nb_fields = 0;
+
+    size_t start = 0;
+    while (true) {
+        size_t end = fen.find(' ', start);
+        std::string_view field = fen.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start);
+        if (field.empty() || nb_fields == 6) {
+            return {FenError::FieldCount, start};
+        }
+        starts[nb_fields] = start;
+        fields[nb_fields++] = field;
+        if (end == std::string_view::npos) {
+            break;
+        }
+        start = end + 1;
+    }
+    if (nb_fields < 4) {
+        return {FenError::FieldCount, fen.size()};
+    }
+
+    position = FenPosition();
+    if (FenError error = parse_board(fields[0], starts[0], position)) {
+        return error;
+    }
+
+    if (fields[1] == "w" || fields[1] == "b") {
+        position.is_white_turn = fields[1] == "w";
+    } else {
+        return {FenError::SideToMove, starts[1]};
+    }
+
+    if (FenError error = parse_castling(fields[2], starts[2], position)) {
+        return error;
+    }
+
+    // The en passant square is behind a pawn that just moved two squares, so its rank depends on the side to move
+    std::string_view en_passant = fields[3];
+    if (en_passant != "-") {
+        char expected_rank = position.is_white_turn ? '6' : '3';
+        if (en_passant.size() != 2 || en_passant[0] < 'a' || en_passant[0] > 'h' || en_passant[1] != expected_rank) {
+            return {FenError::EnPassant, starts[3]};
+        }
+        position.en_passant_square = (en_passant[1] - '1') * 8 + (en_passant[0] - 'a');
+    }
+
+    if (nb_fields >= 5 && !parse_clock(fields[4], position.halfmove_clock)) {
+        return {FenError::HalfMove, starts[4]};
+    }
+    if (nb_fields == 6 && (!parse_clock(fields[5], position.fullmove_number) || position.fullmove_number == 0)) {
+        return {FenError::FullMove, starts[5]};
+    }
+    return {};
+}
+
+} // namespace Chess
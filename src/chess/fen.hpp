@@ -0,0 +1,41 @@
+#pragma once
+
+#include <chess/bitboard.hpp>
+#include <cstddef>
+#include <string_view>
+
+namespace Chess
+{
+
+// Longest FEN write_FEN can produce, terminator included: 71 board characters, 4 castling rights and two 6 digit clocks
+const size_t max_FEN_length = 100;
+
+struct FenError {
+    enum error_code { None, FieldCount, Placement, SideToMove, Castling, EnPassant, HalfMove, FullMove };
+
+    error_code code = None;
+    size_t offset = 0; // Index in the FEN of the first rejected character
+
+    const char *message() const;
+    explicit operator bool() const { return code != None; }
+};
+
+// Everything a FEN describes, filled by parse_FEN without touching a Board
+struct FenPosition {
+    Bitboard by_type[6] = {};
+    Bitboard by_color[2] = {};
+    bool is_white_turn = true;
+    bool king_white_castle = false;
+    bool queen_white_castle = false;
+    bool king_black_castle = false;
+    bool queen_black_castle = false;
+    int en_passant_square = -1;
+    int halfmove_clock = 0;
+    int fullmove_number = 1;
+};
+
+// Strict parser: the four position fields separated by single spaces, optionally followed by the two clocks.
+// It doesn't allocate and leaves position in an unspecified state on error.
+FenError parse_FEN(std::string_view fen, FenPosition &position);
+
+} // namespace Chess
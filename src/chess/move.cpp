@@ -0,0 +1,88 @@
+#include "move.hpp"
+
+namespace Chess
+{
+
+std::string Move::get_clean_coordinate(char pos)
+{
+    char x = pos % 8;
+    char y = pos / 8;
+
+    return std::string(1, 'a' + x) + std::string(1, '1' + y);
+}
+
+std::string Move::to_string(int pos)
+{
+    int rank = pos / 8;
+    int file = pos % 8;
+
+    std::string res = "";
+    res += 'a' + file;
+    res += '1' + rank;
+    return res;
+}
+
+static int parse_square(std::string_view text)
+{
+    if (text[0] < 'a' || text[0] > 'h' || text[1] < '1' || text[1] > '8') {
+        return -1;
+    }
+    return (text[1] - '1') * 8 + text[0] - 'a';
+}
+
+bool Move::parse_UCI(std::string_view text, Move &move)
+{
+    if (text.size() != 4 && text.size() != 5) {
+        return false;
+    }
+    int start_pos = parse_square(text.substr(0, 2));
+    int end_pos = parse_square(text.substr(2, 2));
+    if (start_pos == -1 || end_pos == -1) {
+        return false;
+    }
+    Piece::piece_type promotion = Piece::NONE;
+    if (text.size() == 5) {
+        switch (text[4]) {
+        case 'n':
+            promotion = Piece::Knight;
+            break;
+        case 'b':
+            promotion = Piece::Bishop;
+            break;
+        case 'r':
+            promotion = Piece::Rook;
+            break;
+        case 'q':
+            promotion = Piece::Queen;
+            break;
+        default:
+            return false;
+        }
+    }
+    move = Move(start_pos, end_pos, promotion);
+    return true;
+}
+
+size_t Move::write_UCI(char *buffer) const
+{
+    buffer[0] = 'a' + start_pos() % 8;
+    buffer[1] = '1' + start_pos() / 8;
+    buffer[2] = 'a' + end_pos() % 8;
+    buffer[3] = '1' + end_pos() / 8;
+    if (promotion() == Piece::NONE) {
+        return 4;
+    }
+    buffer[4] = Piece::print_piece(promotion(), false);
+    return 5;
+}
+
+std::ostream &operator<<(std::ostream &os, Move move)
+{
+    os << Move::get_clean_coordinate(move.start_pos()) << Move::get_clean_coordinate(move.end_pos());
+    if (move.promotion() != Piece::piece_type::NONE) {
+        os << Piece::print_piece(move.promotion(), false);
+    }
+    return os;
+}
+
+} // namespace Chess
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "piece.hpp"
+
+namespace Chess
+{
+
+// Packed in 16 bits: start square in bits 0-5, end square in bits 6-11 and flags in bits 12-15.
+// Promotions store Promotion | (type - Knight) in the flags.
+struct Move {
+    enum move_flag { Normal = 0, EnPassant = 1, Castle = 2, Promotion = 4 };
+
+    uint16_t data;
+
+    static std::string get_clean_coordinate(char pos);
+    static std::string to_string(int pos);
+    // Only the squares and the promotion are read, the flags are left to Board::with_flags
+    static bool parse_UCI(std::string_view text, Move &move);
+    // Writes "e2e4" or "e7e8q" without a terminator and returns its length, the buffer must hold 5 characters
+    size_t write_UCI(char *buffer) const;
+    inline Move(int spos, int epos, move_flag flag = Normal) : data(spos | (epos << 6) | (flag << 12)) {}
+    inline Move(int spos, int epos, Piece::piece_type promotion)
+        : data(spos | (epos << 6) | (promotion == Piece::NONE ? 0 : (Promotion | (promotion - Piece::Knight)) << 12))
+    {
+    }
+    inline Move() = default;
+
+    inline int start_pos() const { return data & 0x3F; }
+    inline int end_pos() const { return (data >> 6) & 0x3F; }
+    inline int flags() const { return data >> 12; }
+    inline bool is_en_passant() const { return flags() == EnPassant; }
+    inline bool is_castle() const { return flags() == Castle; }
+    inline Piece::piece_type promotion() const
+    {
+        return (flags() & Promotion) ? (Piece::piece_type)(Piece::Knight + (flags() & 3)) : Piece::NONE;
+    }
+    inline bool operator==(const Move &other) const { return data == other.data; }
+};
+
+// Fixed capacity list that lives on the stack, no position has more than 218 legal moves
+class MoveList
+{
+public:
+    inline void push_back(Move move) { moves[count++] = move; }
+    inline void clear() { count = 0; }
+    inline size_t size() const { return count; }
+    inline bool empty() const { return count == 0; }
+
+    inline Move &operator[](size_t index) { return moves[index]; }
+    inline Move operator[](size_t index) const { return moves[index]; }
+    inline Move *begin() { return moves; }
+    inline Move *end() { return moves + count; }
+    inline const Move *begin() const { return moves; }
+    inline const Move *end() const { return moves + count; }
+
+private:
+    Move moves[256];
+    unsigned count = 0;
+};
+
+std::ostream &operator<<(std::ostream &os, Move move);
+
+} // namespace Chess
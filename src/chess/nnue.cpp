@@ -0,0 +1,417 @@
+#include "nnue.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <utility>
+
+#include "evaluation.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define HAS_X86_KERNELS
+#endif
+
+namespace Chess
+{
+namespace nnue
+{
+
+struct Kernel {
+    const char *name;
+    void (*add)(int16_t *accumulator, const int16_t *weights);
+    void (*sub)(int16_t *accumulator, const int16_t *weights);
+    // Clamps size int16 values (a multiple of 32) to [0, activation_max]
+    void (*activate)(const int16_t *input, uint8_t *output, int size);
+    // output = biases + weights * input, with one row of input_size weights per output. input_size is a multiple of 32,
+    // output_size of 4.
+    void (*affine)(const uint8_t *input, int input_size, const int8_t *weights, const int32_t *biases, int32_t *output, int output_size);
+};
+
+static void add_scalar(int16_t *accumulator, const int16_t *weights)
+{
+    for (int i = 0; i < hidden_size; i++) {
+        accumulator[i] += weights[i];
+    }
+}
+
+static void sub_scalar(int16_t *accumulator, const int16_t *weights)
+{
+    for (int i = 0; i < hidden_size; i++) {
+        accumulator[i] -= weights[i];
+    }
+}
+
+static void activate_scalar(const int16_t *input, uint8_t *output, int size)
+{
+    for (int i = 0; i < size; i++) {
+        output[i] = std::clamp<int>(input[i], 0, activation_max);
+    }
+}
+
+static void affine_scalar(const uint8_t *input, int input_size, const int8_t *weights, const int32_t *biases, int32_t *output, int output_size)
+{
+    for (int o = 0; o < output_size; o++) {
+        int32_t sum = biases[o];
+        for (int i = 0; i < input_size; i++) {
+            sum += input[i] * weights[o * input_size + i];
+        }
+        output[o] = sum;
+    }
+}
+
+#ifdef HAS_X86_KERNELS
+
+// The activations are at most 127 and the weights at least -128, so the pairs summed by maddubs never saturate
+__attribute__((target("avx2"))) static void add_avx2(int16_t *accumulator, const int16_t *weights)
+{
+    for (int i = 0; i < hidden_size; i += 16) {
+        __m256i sum = _mm256_add_epi16(_mm256_loadu_si256((const __m256i *)(accumulator + i)), _mm256_loadu_si256((const __m256i *)(weights + i)));
+        _mm256_storeu_si256((__m256i *)(accumulator + i), sum);
+    }
+}
+
+__attribute__((target("avx2"))) static void sub_avx2(int16_t *accumulator, const int16_t *weights)
+{
+    for (int i = 0; i < hidden_size; i += 16) {
+        __m256i sum = _mm256_sub_epi16(_mm256_loadu_si256((const __m256i *)(accumulator + i)), _mm256_loadu_si256((const __m256i *)(weights + i)));
+        _mm256_storeu_si256((__m256i *)(accumulator + i), sum);
+    }
+}
+
+__attribute__((target("avx2"))) static void activate_avx2(const int16_t *input, uint8_t *output, int size)
+{
+    const __m256i zero = _mm256_setzero_si256();
+
+    for (int i = 0; i < size; i += 32) {
+        __m256i low = _mm256_max_epi16(_mm256_loadu_si256((const __m256i *)(input + i)), zero);
+        __m256i high = _mm256_max_epi16(_mm256_loadu_si256((const __m256i *)(input + i + 16)), zero);
+        // packs saturates to 127 but works on each 128 bit lane, the permute puts the quarters back in order
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(low, high), 0xD8);
+        _mm256_storeu_si256((__m256i *)(output + i), packed);
+    }
+}
+
+// Four rows at a time, so that a single horizontal reduction gives their four sums
+__attribute__((target("avx2"))) static void affine_avx2(const uint8_t *input, int input_size, const int8_t *weights, const int32_t *biases,
+                                                        int32_t *output, int output_size)
+{
+    const __m256i ones = _mm256_set1_epi16(1);
+
+    for (int o = 0; o < output_size; o += 4) {
+        const int8_t *row = weights + o * input_size;
+        __m256i sum0 = _mm256_setzero_si256();
+        __m256i sum1 = sum0;
+        __m256i sum2 = sum0;
+        __m256i sum3 = sum0;
+        for (int i = 0; i < input_size; i += 32) {
+            __m256i x = _mm256_loadu_si256((const __m256i *)(input + i));
+            sum0 = _mm256_add_epi32(sum0, _mm256_madd_epi16(_mm256_maddubs_epi16(x, _mm256_loadu_si256((const __m256i *)(row + i))), ones));
+            sum1 = _mm256_add_epi32(sum1, _mm256_madd_epi16(_mm256_maddubs_epi16(x, _mm256_loadu_si256((const __m256i *)(row + input_size + i))), ones));
+            sum2 = _mm256_add_epi32(sum2, _mm256_madd_epi16(_mm256_maddubs_epi16(x, _mm256_loadu_si256((const __m256i *)(row + 2 * input_size + i))), ones));
+            sum3 = _mm256_add_epi32(sum3, _mm256_madd_epi16(_mm256_maddubs_epi16(x, _mm256_loadu_si256((const __m256i *)(row + 3 * input_size + i))), ones));
+        }
+        __m256i pairs = _mm256_hadd_epi32(_mm256_hadd_epi32(sum0, sum1), _mm256_hadd_epi32(sum2, sum3));
+        __m128i total = _mm_add_epi32(_mm256_castsi256_si128(pairs), _mm256_extracti128_si256(pairs, 1));
+        total = _mm_add_epi32(total, _mm_loadu_si128((const __m128i *)(biases + o)));
+        _mm_storeu_si128((__m128i *)(output + o), total);
+    }
+}
+
+__attribute__((target("ssse3"))) static void add_ssse3(int16_t *accumulator, const int16_t *weights)
+{
+    for (int i = 0; i < hidden_size; i += 8) {
+        __m128i sum = _mm_add_epi16(_mm_loadu_si128((const __m128i *)(accumulator + i)), _mm_loadu_si128((const __m128i *)(weights + i)));
+        _mm_storeu_si128((__m128i *)(accumulator + i), sum);
+    }
+}
+
+__attribute__((target("ssse3"))) static void sub_ssse3(int16_t *accumulator, const int16_t *weights)
+{
+    for (int i = 0; i < hidden_size; i += 8) {
+        __m128i sum = _mm_sub_epi16(_mm_loadu_si128((const __m128i *)(accumulator + i)), _mm_loadu_si128((const __m128i *)(weights + i)));
+        _mm_storeu_si128((__m128i *)(accumulator + i), sum);
+    }
+}
+
+__attribute__((target("ssse3"))) static void activate_ssse3(const int16_t *input, uint8_t *output, int size)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    for (int i = 0; i < size; i += 16) {
+        __m128i low = _mm_max_epi16(_mm_loadu_si128((const __m128i *)(input + i)), zero);
+        __m128i high = _mm_max_epi16(_mm_loadu_si128((const __m128i *)(input + i + 8)), zero);
+        _mm_storeu_si128((__m128i *)(output + i), _mm_packs_epi16(low, high));
+    }
+}
+
+__attribute__((target("ssse3"))) static void affine_ssse3(const uint8_t *input, int input_size, const int8_t *weights, const int32_t *biases,
+                                                          int32_t *output, int output_size)
+{
+    const __m128i ones = _mm_set1_epi16(1);
+
+    for (int o = 0; o < output_size; o += 4) {
+        const int8_t *row = weights + o * input_size;
+        __m128i sum0 = _mm_setzero_si128();
+        __m128i sum1 = sum0;
+        __m128i sum2 = sum0;
+        __m128i sum3 = sum0;
+        for (int i = 0; i < input_size; i += 16) {
+            __m128i x = _mm_loadu_si128((const __m128i *)(input + i));
+            sum0 = _mm_add_epi32(sum0, _mm_madd_epi16(_mm_maddubs_epi16(x, _mm_loadu_si128((const __m128i *)(row + i))), ones));
+            sum1 = _mm_add_epi32(sum1, _mm_madd_epi16(_mm_maddubs_epi16(x, _mm_loadu_si128((const __m128i *)(row + input_size + i))), ones));
+            sum2 = _mm_add_epi32(sum2, _mm_madd_epi16(_mm_maddubs_epi16(x, _mm_loadu_si128((const __m128i *)(row + 2 * input_size + i))), ones));
+            sum3 = _mm_add_epi32(sum3, _mm_madd_epi16(_mm_maddubs_epi16(x, _mm_loadu_si128((const __m128i *)(row + 3 * input_size + i))), ones));
+        }
+        __m128i total = _mm_hadd_epi32(_mm_hadd_epi32(sum0, sum1), _mm_hadd_epi32(sum2, sum3));
+        _mm_storeu_si128((__m128i *)(output + o), _mm_add_epi32(total, _mm_loadu_si128((const __m128i *)(biases + o))));
+    }
+}
+
+static const Kernel kernels[] = {
+    {"avx2", add_avx2, sub_avx2, activate_avx2, affine_avx2},
+    {"ssse3", add_ssse3, sub_ssse3, activate_ssse3, affine_ssse3},
+    {"scalar", add_scalar, sub_scalar, activate_scalar, affine_scalar},
+};
+
+static bool is_supported(const Kernel &kernel)
+{
+    // The kernel is picked by a static initializer, which may run before the libgcc constructor that fills the CPU model
+    __builtin_cpu_init();
+    if (std::strcmp(kernel.name, "avx2") == 0) {
+        return __builtin_cpu_supports("avx2");
+    }
+    if (std::strcmp(kernel.name, "ssse3") == 0) {
+        return __builtin_cpu_supports("ssse3");
+    }
+    return true;
+}
+
+#else
+
+static const Kernel kernels[] = {
+    {"scalar", add_scalar, sub_scalar, activate_scalar, affine_scalar},
+};
+
+static bool is_supported(const Kernel &)
+{
+    return true;
+}
+
+#endif
+
+// The kernels are listed fastest first
+static const Kernel *best_kernel()
+{
+    for (auto &kernel : kernels) {
+        if (is_supported(kernel)) {
+            return &kernel;
+        }
+    }
+    return &kernels[std::size(kernels) - 1];
+}
+
+static const Kernel *kernel = best_kernel();
+
+const char *kernel_name()
+{
+    return kernel->name;
+}
+
+std::vector<const char *> available_kernels()
+{
+    std::vector<const char *> names;
+
+    for (auto &candidate : kernels) {
+        if (is_supported(candidate)) {
+            names.push_back(candidate.name);
+        }
+    }
+    return names;
+}
+
+bool select_kernel(const std::string &name)
+{
+    for (auto &candidate : kernels) {
+        if (name == candidate.name && is_supported(candidate)) {
+            kernel = &candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+void refresh(const Network &network, const Position &position, Accumulator &accumulator)
+{
+    for (int perspective = White; perspective <= Black; perspective++) {
+        std::memcpy(accumulator.values[perspective], network.feature_biases, sizeof(network.feature_biases));
+    }
+    for (int color = White; color <= Black; color++) {
+        for (int type = Piece::Pawn; type <= Piece::King; type++) {
+            Bitboard bb = position.by_type[type] & position.by_color[color];
+            while (bb) {
+                add_piece(network, accumulator, (Color)color, (Piece::piece_type)type, bitboard::pop_lsb(bb));
+            }
+        }
+    }
+}
+
+void add_piece(const Network &network, Accumulator &accumulator, Color color, Piece::piece_type type, int square)
+{
+    kernel->add(accumulator.values[White], network.feature_weights[feature_index(White, color, type, square)]);
+    kernel->add(accumulator.values[Black], network.feature_weights[feature_index(Black, color, type, square)]);
+}
+
+void remove_piece(const Network &network, Accumulator &accumulator, Color color, Piece::piece_type type, int square)
+{
+    kernel->sub(accumulator.values[White], network.feature_weights[feature_index(White, color, type, square)]);
+    kernel->sub(accumulator.values[Black], network.feature_weights[feature_index(Black, color, type, square)]);
+}
+
+bool is_consistent(const Network &network, const Position &position, const Accumulator &accumulator)
+{
+    Accumulator expected;
+
+    refresh(network, position, expected);
+    return std::memcmp(expected.values, accumulator.values, sizeof(expected.values)) == 0;
+}
+
+// The int32 sums of a layer back to activations
+static void scale_down(const int32_t *input, uint8_t *output, int size)
+{
+    for (int i = 0; i < size; i++) {
+        output[i] = std::clamp(input[i] >> weight_shift, 0, activation_max);
+    }
+}
+
+int evaluate(const Network &network, const Accumulator &accumulator, bool is_white_turn)
+{
+    alignas(64) uint8_t input[2 * hidden_size];
+    alignas(64) uint8_t l1_output[l1_size];
+    alignas(64) uint8_t l2_output[l2_size];
+    int32_t sums[l1_size > l2_size ? l1_size : l2_size];
+
+    kernel->activate(accumulator.values[color_of(is_white_turn)], input, hidden_size);
+    kernel->activate(accumulator.values[color_of(!is_white_turn)], input + hidden_size, hidden_size);
+    kernel->affine(input, 2 * hidden_size, &network.l1_weights[0][0], network.l1_biases, sums, l1_size);
+    scale_down(sums, l1_output, l1_size);
+    kernel->affine(l1_output, l1_size, &network.l2_weights[0][0], network.l2_biases, sums, l2_size);
+    scale_down(sums, l2_output, l2_size);
+
+    int32_t output = network.output_bias;
+    for (int i = 0; i < l2_size; i++) {
+        output += l2_output[i] * network.output_weights[i];
+    }
+    return output / output_divisor;
+}
+
+// Every array of the network, in file order
+static std::pair<char *, size_t> arrays(Network &network, size_t index)
+{
+    switch (index) {
+    case 0:
+        return {(char *)network.feature_weights, sizeof(network.feature_weights)};
+    case 1:
+        return {(char *)network.feature_biases, sizeof(network.feature_biases)};
+    case 2:
+        return {(char *)network.l1_weights, sizeof(network.l1_weights)};
+    case 3:
+        return {(char *)network.l1_biases, sizeof(network.l1_biases)};
+    case 4:
+        return {(char *)network.l2_weights, sizeof(network.l2_weights)};
+    case 5:
+        return {(char *)network.l2_biases, sizeof(network.l2_biases)};
+    case 6:
+        return {(char *)network.output_weights, sizeof(network.output_weights)};
+    case 7:
+        return {(char *)&network.output_bias, sizeof(network.output_bias)};
+    default:
+        return {nullptr, 0};
+    }
+}
+
+// The arrays are read and written as they are in memory, which is the file's little-endian layout on x86
+bool load(const std::string &path, Network &network)
+{
+    std::ifstream file(path, std::ios::binary);
+    char magic[4];
+    uint32_t header[2];
+
+    if (!file.read(magic, sizeof(magic)) || !file.read((char *)header, sizeof(header))) {
+        std::cerr << "Could not read the network: " << path << std::endl;
+        return false;
+    }
+    if (std::memcmp(magic, "NNUE", 4) != 0 || header[0] != file_version || header[1] != hidden_size) {
+        std::cerr << "Not a version " << file_version << " network with " << hidden_size << " hidden units: " << path << std::endl;
+        return false;
+    }
+    for (size_t i = 0; arrays(network, i).first; i++) {
+        auto [data, size] = arrays(network, i);
+        if (!file.read(data, size)) {
+            std::cerr << "Truncated network: " << path << std::endl;
+            return false;
+        }
+    }
+    if (file.peek() != std::ifstream::traits_type::eof()) {
+        std::cerr << "Unexpected data after the network: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool save(const std::string &path, const Network &network)
+{
+    std::ofstream file(path, std::ios::binary);
+    const uint32_t header[2] = {file_version, hidden_size};
+
+    file.write("NNUE", 4);
+    file.write((const char *)header, sizeof(header));
+    for (size_t i = 0; arrays(const_cast<Network &>(network), i).first; i++) {
+        auto [data, size] = arrays(const_cast<Network &>(network), i);
+        file.write(data, size);
+    }
+    if (!file) {
+        std::cerr << "Could not write the network: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Each side's half of the accumulator holds the sum of its own pieces, in units of scale centipawns, sliced over
+// nb_slices neurons of activation_max units each so that the clamped activations still add up to the whole sum.
+// The layers after it only copy the slices through, and the output subtracts the opponent's slices from ours.
+void build_from_tables(Network &network)
+{
+    constexpr int scale = 4;
+    constexpr int offset = 32; // Keeps a lone king, whose squares are mostly negative, above 0
+    constexpr int nb_slices = l1_size / 2;
+    constexpr int one = 1 << weight_shift;
+
+    std::memset(&network, 0, sizeof(network));
+    for (int slice = 0; slice < nb_slices; slice++) {
+        network.feature_biases[slice] = offset - activation_max * slice;
+    }
+    for (int type = Piece::Pawn; type <= Piece::King; type++) {
+        for (int square = 0; square < 64; square++) {
+            const evaluation::Score &score = evaluation::psq.scores[White][type][square];
+            int16_t weight = std::lround((score.mg + score.eg) / (2.0 * scale));
+            for (int slice = 0; slice < nb_slices; slice++) {
+                network.feature_weights[feature_index(White, White, (Piece::piece_type)type, square)][slice] = weight;
+            }
+        }
+    }
+    for (int slice = 0; slice < nb_slices; slice++) {
+        network.l1_weights[slice][slice] = one;
+        network.l1_weights[nb_slices + slice][hidden_size + slice] = one;
+    }
+    for (int i = 0; i < l2_size; i++) {
+        network.l2_weights[i][i] = one;
+        network.output_weights[i] = i < nb_slices ? output_divisor * scale : -output_divisor * scale;
+    }
+}
+
+} // namespace nnue
+} // namespace Chess
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "piece.hpp"
+#include "position.hpp"
+
+namespace Chess
+{
+namespace nnue
+{
+
+// 768 inputs, one per (piece color, piece type, square) seen from each side, into an int16 accumulator of hidden_size
+// per side. The two halves, side to move first, go through int8 layers of l1_size and l2_size to a single output.
+constexpr int nb_features = 2 * 6 * 64;
+constexpr int hidden_size = 128;
+constexpr int l1_size = 32;
+constexpr int l2_size = 32;
+constexpr int weight_shift = 6;     // The int8 layer weights have 6 fractional bits
+constexpr int activation_max = 127; // Every activation is clamped to [0, 127]
+constexpr int output_divisor = 16;  // Output to centipawns
+
+struct alignas(64) Network {
+    int16_t feature_weights[nb_features][hidden_size];
+    int16_t feature_biases[hidden_size];
+    int8_t l1_weights[l1_size][2 * hidden_size];
+    int32_t l1_biases[l1_size];
+    int8_t l2_weights[l2_size][l1_size];
+    int32_t l2_biases[l2_size];
+    int8_t output_weights[l2_size];
+    int32_t output_bias;
+};
+
+// Sum of the biases and of the weights of every piece on the board, for each side's point of view
+struct alignas(64) Accumulator {
+    int16_t values[2][hidden_size];
+};
+
+// The file is "NNUE", the little-endian uint32 version and hidden_size, then the arrays of Network in order, little-endian
+constexpr uint32_t file_version = 1;
+bool load(const std::string &path, Network &network);
+bool save(const std::string &path, const Network &network);
+// A network computing the average of the middlegame and endgame values of evaluation::psq, so that the evaluator can
+// be exercised without a trained weights file
+void build_from_tables(Network &network);
+
+// The input of a piece from the point of view of perspective, the board flipped for black
+inline int feature_index(Color perspective, Color color, Piece::piece_type type, int square)
+{
+    return ((color != perspective) * 6 + type) * 64 + (perspective == White ? square : square ^ 56);
+}
+
+void refresh(const Network &network, const Position &position, Accumulator &accumulator);
+void add_piece(const Network &network, Accumulator &accumulator, Color color, Piece::piece_type type, int square);
+void remove_piece(const Network &network, Accumulator &accumulator, Color color, Piece::piece_type type, int square);
+bool is_consistent(const Network &network, const Position &position, const Accumulator &accumulator);
+// Centipawns from the side to move
+int evaluate(const Network &network, const Accumulator &accumulator, bool is_white_turn);
+
+// The AVX2 and SSSE3 kernels are picked once at startup when the CPU supports them, the scalar one otherwise.
+// select_kernel switches kernel for benchmarks, it must not be called while another thread evaluates.
+const char *kernel_name();
+std::vector<const char *> available_kernels();
+bool select_kernel(const std::string &name);
+
+} // namespace nnue
+} // namespace Chess
@@ -0,0 +1,117 @@
+#include "perft.hpp"
+
+#include "WorkStealingPool.hpp"
+
+namespace Chess
+{
+
+// The side to move alternates with the recursion, so it is a template parameter from the root down
+template <Color Us> static uint64_t perft(Board &board, int depth, PerftCache *cache, PerftCache::Stats *stats)
+{
+    constexpr Color Them = Us == White ? Black : White;
+
+    if (depth == 0) {
+        return 1;
+    }
+
+    MoveList moves = board.get_all_legal_moves<Us>();
+    // Bulk counting: the generator is fully legal, so the last ply doesn't need to be played
+    if (depth == 1) {
+        return moves.size();
+    }
+
+    uint64_t nodes = 0;
+    if (cache && cache->probe(board.zobrist_hash, depth, nodes, stats)) {
+        return nodes;
+    }
+    for (auto &move : moves) {
+        UndoInfo undo = board.make_move<Us>(move);
+        nodes += perft<Them>(board, depth - 1, cache, stats);
+        board.unmake_move<Us>(undo);
+    }
+    if (cache) {
+        cache->store(board.zobrist_hash, depth, nodes);
+    }
+    return nodes;
+}
+
+uint64_t perft(Board &board, int depth, PerftCache *cache, PerftCache::Stats *stats)
+{
+    return board.is_white_turn ? perft<White>(board, depth, cache, stats) : perft<Black>(board, depth, cache, stats);
+}
+
+std::vector<std::pair<Move, uint64_t>> perft_divide(Board &board, int depth, PerftCache *cache, PerftCache::Stats *stats)
+{
+    std::vector<std::pair<Move, uint64_t>> result;
+
+    for (auto &move : board.get_all_legal_moves(board.is_white_turn)) {
+        UndoInfo undo = board.make_move(move);
+        result.push_back({move, perft(board, depth - 1, cache, stats)});
+        board.unmake_move(undo);
+    }
+    return result;
+}
+
+// A subtree to count: the position it starts from and the depth left below it
+struct PerftTask {
+    int root_index;
+    Position position;
+    int depth;
+    uint64_t nodes = 0;
+    PerftCache::Stats stats;
+};
+
+std::vector<std::pair<Move, uint64_t>> perft_divide_parallel(
+    const Board &board, int depth, int nb_threads, PerftCache *cache, PerftCache::Stats *stats)
+{
+    Board root = board;
+
+    std::vector<std::pair<Move, uint64_t>> result;
+    std::vector<PerftTask> tasks;
+    for (auto &move : root.get_all_legal_moves(root.is_white_turn)) {
+        UndoInfo undo = root.make_move(move);
+        tasks.push_back({(int)result.size(), root.position(), depth - 1, 0, {}});
+        root.unmake_move(undo);
+        result.push_back({move, 0});
+    }
+
+    // Split one ply deeper while there are too few subtrees to keep every worker busy
+    const size_t wanted_tasks = nb_threads * 16;
+    while (tasks.size() < wanted_tasks && !tasks.empty() && tasks.front().depth > 2) {
+        std::vector<PerftTask> deeper_tasks;
+        for (auto &task : tasks) {
+            root.restore(task.position);
+            for (auto &move : root.get_all_legal_moves(root.is_white_turn)) {
+                root.make_move(move);
+                deeper_tasks.push_back({task.root_index, root.position(), task.depth - 1, 0, {}});
+                root.restore(task.position);
+            }
+        }
+        tasks = std::move(deeper_tasks);
+    }
+
+    {
+        WorkStealingPool pool(nb_threads);
+        std::vector<Board> worker_boards(pool.size(), root);
+
+        for (auto &task : tasks) {
+            pool.submit([&task, &worker_boards, cache](int worker_index) {
+                Board &worker_board = worker_boards[worker_index];
+                worker_board.restore(task.position);
+                task.nodes = perft(worker_board, task.depth, cache, &task.stats);
+            });
+        }
+        pool.wait();
+    }
+
+    // Merged in task order so the result doesn't depend on scheduling
+    for (auto &task : tasks) {
+        result[task.root_index].second += task.nodes;
+        if (stats) {
+            stats->add(task.stats);
+        }
+    }
+    return result;
+}
+
+} // namespace Chess
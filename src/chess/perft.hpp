@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "PerftCache.hpp"
+#include "board.hpp"
+
+namespace Chess
+{
+
+// The cache is optional, stats are only filled when one is given
+uint64_t perft(Board &board, int depth, PerftCache *cache = nullptr, PerftCache::Stats *stats = nullptr);
+std::vector<std::pair<Move, uint64_t>> perft_divide(Board &board, int depth, PerftCache *cache = nullptr, PerftCache::Stats *stats = nullptr);
+std::vector<std::pair<Move, uint64_t>> perft_divide_parallel(
+    const Board &board, int depth, int nb_threads, PerftCache *cache = nullptr, PerftCache::Stats *stats = nullptr);
+
+} // namespace Chess
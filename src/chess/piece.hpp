@@ -1,9 +1,5 @@
 #pragma once
 
-#include <SFML/Graphics.hpp>
-
-#include "ressourceManager.hpp"
-
 namespace Chess
 {
 class Piece
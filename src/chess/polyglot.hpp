@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "board.hpp"
+
+namespace Chess
+{
+namespace polyglot
+{
+
+// Key of a position in Polyglot books, from the format's own random numbers rather than zobrist::pieces. The en
+// passant file only counts when a pawn of the side to move stands next to the pawn that just moved.
+uint64_t key(const Position &position);
+
+// Book moves are from | to << 6 | promotion << 12 with the squares numbered like ours, castling is written as the king
+// taking its own rook
+uint16_t encode_move(Move move);
+// Move(0, 0) when the book move isn't legal in the position, as happens on a key collision
+Move decode_move(const Board &board, uint16_t book_move);
+
+// One 16 byte entry of a book file, stored big-endian and sorted by key
+struct Entry {
+    uint64_t key;
+    uint16_t move;
+    uint16_t weight;
+    uint32_t learn;
+};
+
+struct BookMove {
+    Move move; // With its flags, ready for Board::make_move
+    uint16_t weight;
+};
+
+// A Polyglot .bin book mapped read-only in memory. Nothing is loaded up front: a lookup is a binary search over the
+// mapping, so only the pages it touches are read, whatever the size of the book.
+class Book
+{
+public:
+    enum Selection { Best, Weighted };
+
+    Book() = default;
+    ~Book();
+    Book(const Book &) = delete;
+    Book &operator=(const Book &) = delete;
+
+    bool open(const std::string &path);
+    inline size_t size() const { return nb_entries; }
+
+    // The legal book moves of the position, heaviest first
+    std::vector<BookMove> moves(const Board &board) const;
+    // The heaviest move, or one drawn with a probability proportional to its weight. Move(0, 0) when out of book.
+    Move pick(const Board &board, Selection selection, std::mt19937_64 &rng) const;
+
+private:
+    Entry entry(size_t index) const; // Converted from big-endian
+    size_t lower_bound(uint64_t key) const;
+
+    const Entry *entries = nullptr;
+    size_t nb_entries = 0;
+};
+
+// Sorts the entries and writes them as a book, merging the weights of duplicate moves
+bool write_book(const std::string &path, std::vector<Entry> entries);
+
+} // namespace polyglot
+} // namespace Chess
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+#include "bitboard.hpp"
+#include "piece.hpp"
+
+namespace Chess
+{
+
+// The whole rules state of a position and nothing else, so cloning one is a single 128 byte copy.
+// The bitboards read by every generator fill the first cache line, the rest of the state the second.
+struct alignas(64) Position {
+    Bitboard by_type[6] = {};
+    Bitboard by_color[2] = {};
+
+    uint64_t zobrist_hash = 0;
+    int king_squares[2] = {-1, -1}; // -1 when that king is missing
+    int en_passant_square = -1;     // -1 means no en passant
+    int halfmove_clock = 0;
+    int fullmove_number = 1;
+
+    // Material and piece-square sums of evaluation::psq, white minus black, kept up to date by add_piece and remove_piece
+    int16_t psq_mg = 0;
+    int16_t psq_eg = 0;
+    uint8_t phase = 0;
+
+    bool is_white_turn = true;
+    bool king_white_castle = true;
+    bool queen_white_castle = true;
+    bool king_black_castle = true;
+    bool queen_black_castle = true;
+
+    inline Bitboard pieces(bool is_white, Piece::piece_type type) const { return by_type[type] & by_color[color_of(is_white)]; }
+    inline Bitboard occupied() const { return by_color[White] | by_color[Black]; }
+};
+
+static_assert(std::is_trivially_copyable_v<Position>);
+static_assert(sizeof(Position) <= 128);
+
+} // namespace Chess
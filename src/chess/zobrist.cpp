@@ -0,0 +1,46 @@
+#include "zobrist.hpp"
+
+namespace Chess
+{
+namespace zobrist
+{
+
+uint64_t pieces[2][6][64];
+uint64_t side;
+uint64_t castling[4];
+uint64_t en_passant[8];
+
+// Fixed seed so hashes are the same on every run and every machine
+static uint64_t splitmix64(uint64_t &state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static bool init_keys()
+{
+    uint64_t state = 0x1234ABCD5678EF00ULL;
+
+    for (auto &color : pieces) {
+        for (auto &type : color) {
+            for (auto &key : type) {
+                key = splitmix64(state);
+            }
+        }
+    }
+    side = splitmix64(state);
+    for (auto &key : castling) {
+        key = splitmix64(state);
+    }
+    for (auto &key : en_passant) {
+        key = splitmix64(state);
+    }
+    return true;
+}
+
+static const bool keys_initialized = init_keys();
+
+} // namespace zobrist
+} // namespace Chess
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Chess
+{
+namespace zobrist
+{
+
+extern uint64_t pieces[2][6][64]; // [color][piece type][square]
+extern uint64_t side;             // Toggled when black is to move
+extern uint64_t castling[4];      // White king side, white queen side, black king side, black queen side
+extern uint64_t en_passant[8];    // File of the en passant square
+
+} // namespace zobrist
+} // namespace Chess
@@ -0,0 +1,329 @@
+#include "cli.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <unistd.h>
+
+#include "MoveServer.hpp"
+#include "WorkStealingPool.hpp"
+#include "chess/epd.hpp"
+#include "chess/evaluation.hpp"
+#include "chess/perft.hpp"
+
+void print_search_info(const Chess::SearchResult &result)
+{
+    std::cout << "info depth " << result.depth << " score " << Chess::Search::format_score(result.score) << " nodes " << result.nodes << " nps "
+              << result.nps() << " time " << (int)(result.seconds * 1000) << " pv";
+    for (auto move : result.pv) {
+        std::cout << ' ' << move;
+    }
+    std::cout << std::endl;
+}
+
+int generate_moves(Chess::Board &board)
+{
+    board.print_all_legal_moves();
+    return 0;
+}
+
+int run_perft(Chess::Board &board, int depth, bool divide, int nb_threads, int hash_mb)
+{
+    if (depth < 1) {
+        std::cerr << "Perft depth must be at least 1" << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<Chess::PerftCache> cache;
+    Chess::PerftCache::Stats stats;
+    if (hash_mb > 0) {
+        cache = std::make_unique<Chess::PerftCache>(hash_mb);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t nodes = 0;
+    if (nb_threads > 1) {
+        for (auto &[move, count] : Chess::perft_divide_parallel(board, depth, nb_threads, cache.get(), &stats)) {
+            if (divide) {
+                std::cout << move << ": " << count << std::endl;
+            }
+            nodes += count;
+        }
+        if (divide) {
+            std::cout << std::endl;
+        }
+    } else if (divide) {
+        for (auto &[move, count] : Chess::perft_divide(board, depth, cache.get(), &stats)) {
+            std::cout << move << ": " << count << std::endl;
+            nodes += count;
+        }
+        std::cout << std::endl;
+    } else {
+        nodes = Chess::perft(board, depth, cache.get(), &stats);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << "Nodes: " << nodes << std::endl;
+    std::cout << "Time: " << elapsed.count() << "s" << std::endl;
+    std::cout << "NPS: " << (uint64_t)(nodes / std::max(elapsed.count(), 1e-9)) << std::endl;
+    if (cache) {
+        std::cout << "Hash: " << cache->size() << " entries, " << stats.hits << "/" << stats.probes << " hits ("
+                  << (stats.probes ? 100.0 * stats.hits / stats.probes : 0) << "%)" << std::endl;
+    }
+    return 0;
+}
+
+struct EpdResult {
+    std::string output;
+    std::string errors;
+};
+
+// One "FEN;move count;sorted UCI moves" line per position, checked against the D<depth> operations of the line
+static EpdResult check_epd_line(Chess::Board &board, const std::string &line)
+{
+    EpdResult result;
+    Chess::EpdEntry entry;
+
+    if (!Chess::parse_epd_line(line, entry) || !board.load_from_FEN(entry.fen)) {
+        // The line's own ';' would add fields to the output
+        std::string fields = line;
+        std::replace(fields.begin(), fields.end(), ';', ' ');
+        result.output = fields + ";invalid;";
+        result.errors = "Invalid EPD line: \"" + line + "\"\n";
+        return result;
+    }
+
+    std::vector<std::string> moves;
+    for (auto &move : board.get_all_legal_moves(board.is_white_turn)) {
+        std::stringstream ss;
+        ss << move;
+        moves.push_back(ss.str());
+    }
+    std::sort(moves.begin(), moves.end());
+
+    result.output = entry.fen + ";" + std::to_string(moves.size()) + ";";
+    for (size_t i = 0; i < moves.size(); i++) {
+        result.output += (i == 0 ? "" : " ") + moves[i];
+    }
+
+    for (auto &[depth, expected] : entry.expected_perft) {
+        uint64_t nodes = depth == 1 ? moves.size() : Chess::perft(board, depth);
+        if (nodes != expected) {
+            result.errors += "D" + std::to_string(depth) + " mismatch for \"" + entry.fen + "\": expected " + std::to_string(expected) + ", got "
+                + std::to_string(nodes) + "\n";
+        }
+    }
+    return result;
+}
+
+int run_epd(const std::string &epd_path, int nb_threads)
+{
+    std::ifstream epd_file(epd_path);
+    if (!epd_file) {
+        std::cerr << "Couldn't open file: " << epd_path << std::endl;
+        return 1;
+    }
+
+    WorkStealingPool pool(nb_threads);
+    std::vector<Chess::Board> boards(pool.size());
+    const size_t chunk_size = 4096;
+    size_t nb_positions = 0;
+    size_t nb_errors = 0;
+
+    // The file is streamed in chunks; within a chunk lines are checked in parallel and printed back in file order
+    while (epd_file) {
+        std::vector<std::string> lines;
+        std::string line;
+        while (lines.size() < chunk_size && std::getline(epd_file, line)) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (!line.empty()) {
+                lines.push_back(line);
+            }
+        }
+
+        std::vector<EpdResult> results(lines.size());
+        for (size_t i = 0; i < lines.size(); i++) {
+            pool.submit([&, i](int worker_index) { results[i] = check_epd_line(boards[worker_index], lines[i]); });
+        }
+        pool.wait();
+
+        for (auto &result : results) {
+            std::cout << result.output << '\n';
+            if (!result.errors.empty()) {
+                std::cerr << result.errors;
+                nb_errors += 1;
+            }
+        }
+        nb_positions += lines.size();
+    }
+    std::cout.flush();
+    std::cerr << nb_positions << " positions, " << nb_errors << " error(s)" << std::endl;
+    return nb_errors != 0;
+}
+
+int run_eval(const std::vector<std::string> &positions, const Chess::nnue::Network *network, bool verify)
+{
+    Chess::Board board;
+    int nb_errors = 0;
+    auto is_consistent = [&board]() {
+        return Chess::evaluation::is_consistent(board) && (!board.network || Chess::nnue::is_consistent(*board.network, board, board.accumulator));
+    };
+
+    board.set_network(network);
+    for (auto &position : positions) {
+        if (!board.load_from_FEN(position)) {
+            nb_errors += 1;
+            continue;
+        }
+        int score = board.evaluate();
+        std::cout << position << ';' << (board.is_white_turn ? score : -score) << '\n';
+        if (!verify) {
+            continue;
+        }
+        bool consistent = is_consistent();
+        for (auto move : board.get_all_legal_moves(board.is_white_turn)) {
+            Chess::UndoInfo undo = board.make_move(move);
+            if (!is_consistent()) {
+                std::cerr << "Evaluation out of date after " << move << " in \"" << position << "\"" << std::endl;
+                consistent = false;
+            }
+            board.unmake_move(undo);
+        }
+        nb_errors += !consistent || !is_consistent();
+    }
+    std::cout.flush();
+    std::cerr << positions.size() << " positions, " << nb_errors << " error(s)" << std::endl;
+    return nb_errors != 0;
+}
+
+int run_see(const std::vector<std::string> &positions, bool verify)
+{
+    Chess::Board board;
+    int nb_errors = 0;
+
+    for (auto &position : positions) {
+        if (!board.load_from_FEN(position)) {
+            nb_errors += 1;
+            continue;
+        }
+        std::cout << position << ';';
+        bool consistent = true;
+        for (auto move : board.get_all_legal_moves(board.is_white_turn)) {
+            int value = board.see(move);
+            if (board.type_at(move.end_pos()) != Chess::Piece::NONE || move.is_en_passant() || move.promotion() != Chess::Piece::NONE) {
+                std::cout << ' ' << move << ':' << value;
+            }
+            if (!verify) {
+                continue;
+            }
+            for (int threshold : {value - 1, value, value + 1, -1000, -250, -100, 0, 100, 250, 1000}) {
+                if (board.see_ge(move, threshold) != (value >= threshold)) {
+                    std::cerr << "see_ge " << threshold << " disagrees with see " << value << " for " << move << " in \"" << position << "\""
+                              << std::endl;
+                    consistent = false;
+                }
+            }
+        }
+        std::cout << '\n';
+        nb_errors += !consistent;
+    }
+    std::cout.flush();
+    std::cerr << positions.size() << " positions, " << nb_errors << " error(s)" << std::endl;
+    return nb_errors != 0;
+}
+
+int run_search(Chess::Board &board, const Chess::SearchLimits &limits, int hash_mb, OpeningBook &book)
+{
+    if (Chess::Move book_move = book.pick(board); book_move.data != 0) {
+        std::cout << "bestmove " << book_move << std::endl;
+        std::cerr << "book move" << std::endl;
+        return 0;
+    }
+    Chess::Search search(hash_mb);
+    Chess::SearchResult result = search.run(board, limits, print_search_info);
+
+    if (result.best_move.data == 0) {
+        std::cout << "bestmove (none)" << std::endl;
+        return 0;
+    }
+    std::cout << "bestmove " << result.best_move << std::endl;
+    std::cerr << result.nodes << " nodes in " << result.seconds << " s (" << result.nps() << " nodes/s)" << std::endl;
+    return 0;
+}
+
+int run_book_moves(Chess::Board &board, OpeningBook &book)
+{
+    std::vector<Chess::polyglot::BookMove> moves = book.book.moves(board);
+    uint32_t total = 0;
+
+    for (auto &book_move : moves) {
+        total += book_move.weight;
+    }
+    char key[17];
+    snprintf(key, sizeof(key), "%016llx", (unsigned long long)Chess::polyglot::key(board));
+    std::cout << "key " << key << '\n';
+    for (auto &book_move : moves) {
+        std::cout << book_move.move << ' ' << book_move.weight << ' ' << (total ? 100.0 * book_move.weight / total : 0) << "%\n";
+    }
+    Chess::Move pick = book.pick(board);
+    if (pick.data == 0) {
+        std::cout << "pick (none)" << std::endl;
+        return 0;
+    }
+    std::cout << "pick " << pick << std::endl;
+    return 0;
+}
+
+int write_book(const std::string &lines_path, const std::string &book_path)
+{
+    std::ifstream file(lines_path);
+    std::vector<Chess::polyglot::Entry> entries;
+    Chess::Board board;
+    std::string line;
+    int line_number = 0;
+
+    if (!file) {
+        std::cerr << "Couldn't open file: " << lines_path << std::endl;
+        return 1;
+    }
+    while (std::getline(file, line)) {
+        line_number += 1;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        board.load_from_FEN(Chess::default_FEN);
+        std::istringstream stream(line);
+        std::string text;
+        while (stream >> text) {
+            Chess::Move move(0, 0);
+            if (!Chess::Move::parse_UCI(text, move) || !board.is_legal(move = board.with_flags(move))) {
+                std::cerr << lines_path << ':' << line_number << ": illegal move " << text << std::endl;
+                return 1;
+            }
+            entries.push_back({Chess::polyglot::key(board), Chess::polyglot::encode_move(move), 1, 0});
+            board.make_move(move);
+        }
+    }
+    if (!Chess::polyglot::write_book(book_path, entries)) {
+        return 1;
+    }
+    std::cerr << entries.size() << " book moves written to " << book_path << std::endl;
+    return 0;
+}
+
+int run_serve(const std::string &target, int nb_boards, int nb_threads)
+{
+    MoveServer server(nb_boards, nb_threads);
+
+    if (target == "-") {
+        server.serve_stream(STDIN_FILENO, STDOUT_FILENO);
+        return 0;
+    }
+    return server.serve_socket(target);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "chess/Search.hpp"
+#include "chess/board.hpp"
+#include "chess/nnue.hpp"
+#include "chess/polyglot.hpp"
+
+// The --book file and how its moves are picked, they are played without searching as long as the game is in it
+struct OpeningBook {
+    Chess::polyglot::Book book;
+    Chess::polyglot::Book::Selection selection = Chess::polyglot::Book::Weighted;
+    std::mt19937_64 rng{std::random_device{}()};
+
+    Chess::Move pick(const Chess::Board &board) { return book.size() ? book.pick(board, selection, rng) : Chess::Move(0, 0); }
+};
+
+// One line per depth searched, in the format of UCI engines
+void print_search_info(const Chess::SearchResult &result);
+
+// The modes that run without the gui, each returns the exit code of the program
+int generate_moves(Chess::Board &board);
+// Node count, speed and cache hits of a perft of the position, below each root move with divide
+int run_perft(Chess::Board &board, int depth, bool divide, int nb_threads, int hash_mb);
+// One "FEN;move count;sorted UCI moves" line per position of the file, checked against its D<depth> operations
+int run_epd(const std::string &epd_path, int nb_threads);
+// Prints "<FEN>;<score>" with the static evaluation in centipawns for white, from the network when one is given. With
+// verify, the incremental sums and accumulator are compared to a full recomputation after each legal move.
+int run_eval(const std::vector<std::string> &positions, const Chess::nnue::Network *network, bool verify);
+// Prints "<FEN>;<move>:<value> ..." with the static exchange value of every capture and promotion. With verify, see_ge
+// is checked against see for every legal move and thresholds on both sides of its value.
+int run_see(const std::vector<std::string> &positions, bool verify);
+
+// "bestmove <move>" from the book when the position is in it, from a search otherwise
+int run_search(Chess::Board &board, const Chess::SearchLimits &limits, int hash_mb, OpeningBook &book);
+// Prints "key <hex>" with the Polyglot key of the position, "<move> <weight> <percent>%" for every book move of it,
+// then the one --book-select picks
+int run_book_moves(Chess::Board &board, OpeningBook &book);
+
+// Every position of every line of UCI moves played from the start position gets an entry for the move that follows,
+// weighted by the number of lines playing it there
+int write_book(const std::string &lines_path, const std::string &book_path);
+// Serves MoveServer requests on stdin/stdout ("-") or on a Unix socket path
+int run_serve(const std::string &target, int nb_boards, int nb_threads);
@@ -2,15 +2,26 @@
 #include <SFML/System/Vector2.hpp>
 #include <algorithm>
 #include <argparse/argparse.hpp>
+#include <chrono>
 #include <cmath>
+#include <future>
 #include <iostream>
+#include <memory>
 
 #include "ArrowsManager.hpp"
+#include "GameServer.hpp"
+#include "GuiBoard.hpp"
+#include "LoadTest.hpp"
+#include "bench.hpp"
 #include "chess/board.hpp"
+#include "chess/nnue.hpp"
+#include "chess/Search.hpp"
 #include "chess/piece.hpp"
+#include "chess/polyglot.hpp"
+#include "cli.hpp"
 #include "ressourceManager.hpp"
 
-void on_left_mouse_clicked(Chess::Board &board, sf::Vector2i position, ArrowsManager &arrows, bool is_release)
+void on_left_mouse_clicked(Chess::GuiBoard &board, sf::Vector2i position, ArrowsManager &arrows, bool is_release)
 {
     int pos = board.get_square_from_mouse(position);
     if (pos != -1) {
@@ -21,25 +32,20 @@ void on_left_mouse_clicked(Chess::Board &board, sf::Vector2i position, ArrowsMan
             Chess::Piece::piece_type selection_type = board.promotion_popup->select(pos);
             if (selection_type != Chess::Piece::NONE) {
                 auto base_move = board.promotion_popup->move;
-                base_move.promotion = selection_type;
-                board.play_move(base_move);
+                board.play_move(Chess::Move(base_move.start_pos(), base_move.end_pos(), selection_type));
             } else {
                 board.selected_piece = -1;
             }
         } else if (board.selected_piece != -1) {
-            auto &vec = board.moves_for_selected_piece;
-            auto move_found = std::find(vec.begin(), vec.end(), pos);
-            if (move_found != vec.end()) {
-                if ((std::find(move_found + 1, vec.end(), pos) != vec.end())) { // If promotion
-                    was_move_played = true;
-                    board.promotion_popup->show(Chess::Move(board.selected_piece, pos));
-                    board.selected_piece = -1;
-
-                } else {
-                    board.play_move(Chess::Move(board.selected_piece, pos));
-                    board.display_square_moves(-1);
-                    was_move_played = true;
-                }
+            Chess::Move move = board.with_flags(Chess::Move(board.selected_piece, pos));
+            if (board.is_legal(Chess::Move(board.selected_piece, pos, Chess::Piece::Queen))) { // If promotion
+                was_move_played = true;
+                board.promotion_popup->show(Chess::Move(board.selected_piece, pos));
+                board.selected_piece = -1;
+            } else if (board.is_legal(move)) {
+                board.play_move(move);
+                board.display_square_moves(-1);
+                was_move_played = true;
             }
         }
 
@@ -53,7 +59,21 @@ void on_left_mouse_clicked(Chess::Board &board, sf::Vector2i position, ArrowsMan
     }
 }
 
-int graphics_loop(Chess::Board &board, argparse::ArgumentParser &program)
+// --depth, --nodes and --movetime, one second per move when none is given
+Chess::SearchLimits search_limits(argparse::ArgumentParser &program)
+{
+    Chess::SearchLimits limits;
+
+    limits.depth = program.get<int>("--depth");
+    limits.nodes = program.get<int>("--nodes");
+    limits.time_ms = program.get<int>("--movetime");
+    if (limits.depth <= 0 && limits.nodes <= 0 && limits.time_ms <= 0) {
+        limits.time_ms = 1000;
+    }
+    return limits;
+}
+
+int graphics_loop(Chess::GuiBoard &board, argparse::ArgumentParser &program, OpeningBook &book)
 {
     sf::RenderWindow window(sf::VideoMode(1280, 720), "Chess GUI");
     RessourceManager manager(program.get<std::string>("--pieces"));
@@ -65,6 +85,33 @@ int graphics_loop(Chess::Board &board, argparse::ArgumentParser &program)
     ArrowsManager arrowsManager;
     int right_click_pos = -1;
 
+    // The engine thinks on a copy of the board, its move is dropped if the position changed meanwhile
+    Chess::Search search(std::max(program.get<int>("--hash"), 16));
+    Chess::SearchLimits limits = search_limits(program);
+    std::future<Chess::SearchResult> pending_search;
+    uint64_t searched_hash = 0;
+    bool engine_plays = false;
+    auto start_search = [&](bool play) {
+        if (pending_search.valid() || board.promotion_popup->visible) {
+            return;
+        }
+        if (Chess::Move book_move = book.pick(board); book_move.data != 0) {
+            if (play) {
+                arrowsManager.arrows_list.clear();
+                board.play_move(book_move);
+                board.selected_piece = -1;
+            } else {
+                arrowsManager.add_arrow(book_move.start_pos(), book_move.end_pos(), board);
+            }
+            return;
+        }
+        searched_hash = board.zobrist_hash;
+        engine_plays = play;
+        pending_search = std::async(std::launch::async, [&search, limits, copy = Chess::Board(board)]() mutable {
+            return search.run(copy, limits, print_search_info);
+        });
+    };
+
     window.setFramerateLimit(60);
     while (window.isOpen()) {
         sf::Event event;
@@ -104,7 +151,7 @@ int graphics_loop(Chess::Board &board, argparse::ArgumentParser &program)
             if (event.type == sf::Event::KeyPressed) {
                 if (event.key.code == sf::Keyboard::R) {
                     board.load_from_FEN(Chess::default_FEN);
-                    board.move_history.reset(Chess::default_FEN);
+                    board.move_history.reset(Chess::default_FEN, board.zobrist_hash);
                     board.selected_piece = -1;
                 }
                 if (event.key.code == sf::Keyboard::S) {
@@ -115,16 +162,37 @@ int graphics_loop(Chess::Board &board, argparse::ArgumentParser &program)
                     board.selected_piece = -1;
                 }
                 if (event.key.code == sf::Keyboard::Left) {
-                    if (board.move_history.undo()) {
-                        board.load_from_FEN(board.move_history.get_active_fen());
-                    }
+                    board.undo_move();
                 }
                 if (event.key.code == sf::Keyboard::Right) {
-                    if (board.move_history.redoo()) {
-                        board.load_from_FEN(board.move_history.get_active_fen());
+                    if (board.redo_move()) {
                         board.selected_piece = -1;
                     }
                 }
+                if (event.key.code == sf::Keyboard::H) {
+                    start_search(false);
+                }
+                if (event.key.code == sf::Keyboard::E) {
+                    start_search(true);
+                }
+                if (event.key.code == sf::Keyboard::B && !board.promotion_popup->visible) {
+                    arrowsManager.arrows_list.clear();
+                    for (auto &book_move : book.book.moves(board)) {
+                        arrowsManager.add_arrow(book_move.move.start_pos(), book_move.move.end_pos(), board);
+                    }
+                }
+            }
+        }
+        if (pending_search.valid() && pending_search.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            Chess::Move best_move = pending_search.get().best_move;
+            if (best_move.data != 0 && board.zobrist_hash == searched_hash && !board.promotion_popup->visible) {
+                if (engine_plays) {
+                    arrowsManager.arrows_list.clear();
+                    board.play_move(best_move);
+                    board.selected_piece = -1;
+                } else {
+                    arrowsManager.add_arrow(best_move.start_pos(), best_move.end_pos(), board);
+                }
             }
         }
 
@@ -136,23 +204,14 @@ int graphics_loop(Chess::Board &board, argparse::ArgumentParser &program)
     return 0;
 }
 
-int generate_moves(Chess::Board &board)
-{
-    board.print_all_legal_moves();
-    return 0;
-}
-
-Chess::Board setup_board(argparse::ArgumentParser &program)
+void setup_board(Chess::Board &board, argparse::ArgumentParser &program)
 {
-    Chess::Board board;
-
     std::string FEN = program.get<std::string>("--FEN");
     board.log_FEN = program.get<bool>("--log_FEN");
     if (!board.load_from_FEN(FEN)) {
         exit(1);
     }
-    board.move_history.reset(FEN);
-    return board;
+    board.move_history.reset(FEN, board.zobrist_hash);
 }
 
 int main(int argc, char **argv)
@@ -166,6 +225,31 @@ int main(int argc, char **argv)
     program.add_argument("--pieces").help("Folder containing the pieces sprites").default_value("./default_textures/pieces/regular").nargs(1);
     program.add_argument("--board").help("Folder containing the board sprite").default_value("./default_textures/board.jpg").nargs(1);
     program.add_argument("--get_moves").help("Doesn't start the gui; list all moves from position").default_value(false).implicit_value(true);
+    program.add_argument("--perft").help("Doesn't start the gui; count leaf nodes up to the given depth").scan<'i', int>().nargs(1);
+    program.add_argument("--epd").help("Doesn't start the gui; list the moves of every position of an EPD file and check its D<depth> counts").nargs(1);
+    program.add_argument("--threads").help("Number of worker threads for --perft, --epd, --serve and --game-server").default_value(1).scan<'i', int>().nargs(1);
+    program.add_argument("--hash").help("Size in MB of the perft transposition cache (0 disables it) or of the search one (16 below that)").default_value(0).scan<'i', int>().nargs(1);
+    program.add_argument("--search").help("Doesn't start the gui; search the best move of the position with the --depth, --nodes and --movetime limits").default_value(false).implicit_value(true);
+    program.add_argument("--depth").help("Depth limit of --search and of the gui engine (H for a hint, E to let it play)").default_value(0).scan<'i', int>().nargs(1);
+    program.add_argument("--nodes").help("Node limit of the search").default_value(0).scan<'i', int>().nargs(1);
+    program.add_argument("--movetime").help("Time limit of the search in milliseconds, 1000 when no limit is given").default_value(0).scan<'i', int>().nargs(1);
+    program.add_argument("--bench").help("Doesn't start the gui; run a micro benchmark (fen, movegen, attacks, serve, search, nnue, book) on --epd or the perft positions").nargs(1);
+    program.add_argument("--serve").help("Doesn't start the gui; answer move generation requests on stdin/stdout (-) or on a Unix socket path").nargs(1);
+    program.add_argument("--boards").help("Number of boards --serve requests can address").default_value(64).scan<'i', int>().nargs(1);
+    program.add_argument("--game-server").help("Doesn't start the gui; host --games concurrent games on a host:port TCP address or a Unix socket path").nargs(1);
+    program.add_argument("--load-test").help("Doesn't start the gui; play random moves in --games concurrent games on a --game-server, one connection per --threads").nargs(1);
+    program.add_argument("--games").help("Number of games --game-server can host and --load-test opens").default_value(10000).scan<'i', int>().nargs(1);
+    program.add_argument("--eval").help("Doesn't start the gui; print the static evaluation of --FEN or of every position of --epd").default_value(false).implicit_value(true);
+    program.add_argument("--verify").help("With --eval, check the incremental evaluation against a full recomputation after every legal move; with --see, check see_ge against see").default_value(false).implicit_value(true);
+    program.add_argument("--see").help("Doesn't start the gui; print the static exchange value of every capture of --FEN or of every position of --epd").default_value(false).implicit_value(true);
+    program.add_argument("--nnue").help("Evaluate with the network of this weights file instead of the piece-square tables").nargs(1);
+    program.add_argument("--write-nnue").help("Doesn't start the gui; write a network reproducing the piece-square tables to this file").nargs(1);
+    program.add_argument("--book").help("Polyglot opening book whose moves --search and the gui engine play instantly (B shows them all)").nargs(1);
+    program.add_argument("--book-select").help("How a book move is picked: best (the heaviest) or weighted (random, proportional to the weights)").default_value(std::string("weighted")).nargs(1);
+    program.add_argument("--book-moves").help("Doesn't start the gui; list the --book moves of the position and the one picked").default_value(false).implicit_value(true);
+    program.add_argument("--write-book").help("Doesn't start the gui; write a Polyglot book of the UCI move lines of --lines to this file").nargs(1);
+    program.add_argument("--lines").help("File of UCI move lines from the starting position, one game per line, for --write-book").nargs(1);
+    program.add_argument("--divide").help("With --perft, print the node count below each root move").default_value(false).implicit_value(true);
 
     try {
         program.parse_args(argc, argv);
@@ -181,11 +265,77 @@ int main(int argc, char **argv)
         std::cout << program << std::endl;
         return 0;
     }
-    Chess::Board board = setup_board(program);
-    if (print_moves) {
+    if (auto path = program.present<std::string>("--write-nnue")) {
+        auto tables = std::make_unique<Chess::nnue::Network>();
+        Chess::nnue::build_from_tables(*tables);
+        return !Chess::nnue::save(*path, *tables);
+    }
+    if (auto path = program.present<std::string>("--write-book")) {
+        auto lines_path = program.present<std::string>("--lines");
+        if (!lines_path) {
+            std::cerr << "--write-book needs a --lines file" << std::endl;
+            return 1;
+        }
+        return write_book(*lines_path, *path);
+    }
+    std::unique_ptr<Chess::nnue::Network> network;
+    if (auto path = program.present<std::string>("--nnue")) {
+        network = std::make_unique<Chess::nnue::Network>();
+        if (!Chess::nnue::load(*path, *network)) {
+            return 1;
+        }
+    }
+    OpeningBook book;
+    if (auto path = program.present<std::string>("--book")) {
+        if (!book.book.open(*path)) {
+            return 1;
+        }
+    }
+    std::string selection = program.get<std::string>("--book-select");
+    if (selection != "best" && selection != "weighted") {
+        std::cerr << "Unknown book selection: " << selection << " (available: best, weighted)" << std::endl;
+        return 1;
+    }
+    book.selection = selection == "best" ? Chess::polyglot::Book::Best : Chess::polyglot::Book::Weighted;
+    if (auto bench_name = program.present<std::string>("--bench")) {
+        return run_bench(*bench_name, program.present<std::string>("--epd"), program.get<int>("--threads"), network.get(), book);
+    }
+    if (auto serve_target = program.present<std::string>("--serve")) {
+        return run_serve(*serve_target, program.get<int>("--boards"), program.get<int>("--threads"));
+    }
+    if (auto address = program.present<std::string>("--game-server")) {
+        GameServer server(program.get<int>("--games"), program.get<int>("--threads"));
+        return server.serve(*address);
+    }
+    if (auto address = program.present<std::string>("--load-test")) {
+        return run_load_test(*address, program.get<int>("--games"), std::max(program.get<int>("--threads"), 1));
+    }
+    if (program.get<bool>("--eval")) {
+        auto epd_path = program.present<std::string>("--epd");
+        std::vector<std::string> positions = epd_path ? load_bench_positions(epd_path) : std::vector{program.get<std::string>("--FEN")};
+        return run_eval(positions, network.get(), program.get<bool>("--verify"));
+    }
+    if (program.get<bool>("--see")) {
+        auto epd_path = program.present<std::string>("--epd");
+        std::vector<std::string> positions = epd_path ? load_bench_positions(epd_path) : std::vector{program.get<std::string>("--FEN")};
+        return run_see(positions, program.get<bool>("--verify"));
+    }
+    if (auto epd_path = program.present<std::string>("--epd")) {
+        return run_epd(*epd_path, program.get<int>("--threads"));
+    }
+    Chess::GuiBoard board;
+    setup_board(board, program);
+    board.set_network(network.get());
+    if (auto depth = program.present<int>("--perft")) {
+        return run_perft(board, *depth, program.get<bool>("--divide"), program.get<int>("--threads"), program.get<int>("--hash"));
+    } else if (program.get<bool>("--search")) {
+        return run_search(board, search_limits(program), std::max(program.get<int>("--hash"), 16), book);
+    } else if (program.get<bool>("--book-moves")) {
+        return run_book_moves(board, book);
+    } else if (print_moves) {
         generate_moves(board);
     } else {
-        graphics_loop(board, program);
+        graphics_loop(board, program, book);
     }
 
     return 0;
@@ -0,0 +1,83 @@
+#!/bin/python3
+from pathlib import Path
+import subprocess
+import tempfile
+from colorama import Fore, Style
+from sys import argv
+
+# The keys given with the Polyglot book format, the en passant ones only count the file when the capture is possible
+REFERENCE_KEYS = [
+    ("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", "463b96181691fc9c"),
+    ("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1", "823c9b50fd114196"),
+    ("rnbqkbnr/ppp1pppp/8/3p4/4P3/8/PPPP1PPP/RNBQKBNR w KQkq d6 0 2", "0756b94461c50fb0"),
+    ("rnbqkbnr/ppp1pppp/8/3pP3/8/8/PPPP1PPP/RNBQKBNR b KQkq - 0 2", "662fafb965db29d4"),
+    ("rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3", "22a48b5a8e47ff78"),
+    ("rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR b kq - 0 3", "652a607ca3f242c1"),
+    ("rnbq1bnr/ppp1pkpp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR w - - 0 4", "00fdd303c946bdd9"),
+    ("rnbqkbnr/p1pppppp/8/8/PpP4P/8/1P1PPPP1/RNBQKBNR b KQkq c3 0 3", "3c8123ea7b067637"),
+    ("rnbqkbnr/p1pppppp/8/8/P6P/R1p5/1P1PPPP1/1NBQKBNR b Kkq - 0 4", "5c3f9b829b279560"),
+]
+
+# The moves of openings.bin from the starting position, with their weights
+START_MOVES = {"e2e4": 13, "d2d4": 9, "c2c4": 2, "g1f3": 1}
+
+error_count = 0
+
+
+def fail(message: str):
+    global error_count
+
+    print(f"{Fore.RED}{message}{Style.RESET_ALL}")
+    error_count += 1
+
+
+def book_moves(chess_gui: Path, *args: str):
+    chess_gui_proc = subprocess.run([chess_gui, "--book-moves", *args], capture_output=True)
+    if chess_gui_proc.returncode != 0:
+        fail(f"GUI failed on --book-moves {' '.join(args)} (exit code {chess_gui_proc.returncode})")
+        return []
+    return chess_gui_proc.stdout.decode().splitlines()
+
+
+def check_keys(chess_gui: Path):
+    for FEN, expected in REFERENCE_KEYS:
+        lines = book_moves(chess_gui, "--FEN", FEN)
+        if not lines or lines[0] != f"key {expected}":
+            fail(f"Wrong Polyglot key for FEN {FEN}: expected {expected}, got {lines[0] if lines else 'nothing'}")
+
+
+def check_book(chess_gui: Path, books: Path):
+    lines = book_moves(chess_gui, "--book", books / "openings.bin", "--book-select", "best")
+    moves = {move: int(weight) for move, weight, _ in (line.split() for line in lines[1:-1])}
+    if moves != START_MOVES:
+        fail(f"Wrong book moves from the starting position: expected {START_MOVES}, got {moves}")
+    if not lines or lines[-1] != "pick e2e4":
+        fail(f"Wrong best book move from the starting position: {lines[-1] if lines else 'nothing'}")
+
+    # The book in the tree must be the one --write-book makes from its lines
+    with tempfile.TemporaryDirectory() as directory:
+        written = Path(directory) / "openings.bin"
+        chess_gui_proc = subprocess.run([chess_gui, "--write-book", written, "--lines", books / "openings.txt"], capture_output=True)
+        if chess_gui_proc.returncode != 0 or written.read_bytes() != (books / "openings.bin").read_bytes():
+            fail(f"--write-book doesn't reproduce {books / 'openings.bin'} from {books / 'openings.txt'}")
+
+
+def main():
+    if "-h" in argv or "--help" in argv or len(argv) != 3:
+        print(f"Usage: {argv[0]} [chess_gui_exec] [books directory]")
+        return False
+    chess_gui = Path(argv[1])
+    books = Path(argv[2])
+
+    check_keys(chess_gui)
+    check_book(chess_gui, books)
+
+    if error_count == 0:
+        print(f"{Fore.GREEN}Opening book tests ok!{Style.RESET_ALL}")
+        return True
+    print(f"{Fore.RED}{error_count = } book test(s) failed{Style.RESET_ALL}")
+    return False
+
+
+if __name__ == "__main__":
+    exit(0 if main() else 1)